@@ -16,6 +16,7 @@
 #include <common/debug.h>
 #include <context.h>
 #include <drivers/auth/auth_mod.h>
+#include <drivers/auth/crypto_mod.h>
 #include <lib/el3_runtime/context_mgmt.h>
 #include <lib/utils.h>
 #include <plat/common/platform.h>
@@ -361,6 +362,21 @@ static int bl1_fwu_image_copy(unsigned int image_id,
 	return 0;
 }
 
+/*******************************************************************************
+ * This function drops any image hash kept by the crypto module. Images are
+ * rewritten in place by the FWU SMCs, so such a hash must never be used to
+ * authenticate or measure them.
+ ******************************************************************************/
+static void bl1_fwu_drop_image_hash(void)
+{
+#if IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE
+	(void)crypto_mod_hash_finish(true);
+#endif
+#if CRYPTO_HASH_REUSE
+	crypto_mod_image_hash_drop();
+#endif
+}
+
 /*******************************************************************************
  * This function is responsible for authenticating Normal/Secure images.
  ******************************************************************************/
@@ -442,7 +458,9 @@ static int bl1_fwu_image_auth(unsigned int image_id,
 	 * Authenticate the image.
 	 */
 	INFO("BL1-FWU: Authenticating image_id:%d\n", image_id);
+	bl1_fwu_drop_image_hash();
 	result = auth_mod_verify_img(image_id, (void *)base_addr, total_size);
+	bl1_fwu_drop_image_hash();
 	if (result != 0) {
 		WARN("BL1-FWU: Authentication Failed err=%d\n", result);
 
@@ -732,6 +750,7 @@ static int bl1_fwu_image_reset(unsigned int image_id, unsigned int flags)
 
 		/* Clear authentication state */
 		auth_img_flags[image_id] = 0;
+		bl1_fwu_drop_image_hash();
 
 		break;
 
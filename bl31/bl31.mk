@@ -62,6 +62,14 @@ ifeq (${ENABLE_PMF}, 1)
 BL31_SOURCES		+=	lib/pmf/pmf_main.c
 endif
 
+ifeq (${ENABLE_SMC_LATENCY_HIST},1)
+BL31_SOURCES		+=	lib/pmf/pmf_smc_hist.c
+endif
+
+ifeq (${ENABLE_EL3_TRACE},1)
+BL31_SOURCES		+=	lib/el3_trace/el3_trace.c
+endif
+
 include lib/debugfs/debugfs.mk
 ifeq (${USE_DEBUGFS},1)
 	BL31_SOURCES	+= $(DEBUGFS_SRCS)
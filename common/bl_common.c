@@ -1,11 +1,12 @@
 /*
- * Copyright (c) 2013-2022, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2023, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <arch.h>
@@ -14,11 +15,22 @@
 #include <common/bl_common.h>
 #include <common/debug.h>
 #include <drivers/auth/auth_mod.h>
+#include <drivers/auth/crypto_mod.h>
 #include <drivers/io/io_storage.h>
 #include <lib/utils.h>
+#include <lib/utils_def.h>
 #include <lib/xlat_tables/xlat_tables_defs.h>
 #include <plat/common/platform.h>
 
+#include <platform_def.h>
+
+#if IMAGE_HASH_STREAMING
+/* Size of the chunks in which images are read and hashed */
+#ifndef PLAT_IMAGE_LOAD_CHUNK_SIZE
+#define PLAT_IMAGE_LOAD_CHUNK_SIZE	U(0x10000)
+#endif
+#endif /* IMAGE_HASH_STREAMING */
+
 #if TRUSTED_BOARD_BOOT
 # ifdef DYN_DISABLE_AUTH
 static int disable_auth;
@@ -59,15 +71,64 @@ uintptr_t page_align(uintptr_t value, unsigned dir)
 	return value;
 }
 
+#if IMAGE_HASH_STREAMING
+/*******************************************************************************
+ * Internal function to read an image in chunks of PLAT_IMAGE_LOAD_CHUNK_SIZE
+ * bytes, handing each chunk to the crypto module right after reading it, while
+ * it is still in the data cache. The crypto module then verifies the hash of
+ * the image without hashing it again. If the crypto module can't hash the
+ * image, the rest of it is read as usual.
+ ******************************************************************************/
+static int read_image_hashed(uintptr_t image_handle, uintptr_t image_base,
+			     size_t image_size, size_t *length_read)
+{
+	size_t chunk, bytes_read;
+	bool hashing;
+	int io_result = 0;
+
+	hashing = (crypto_mod_hash_start((void *)image_base) == 0);
+
+	*length_read = 0U;
+	while (*length_read < image_size) {
+		chunk = image_size - *length_read;
+		if (hashing) {
+			chunk = MIN(chunk, (size_t)PLAT_IMAGE_LOAD_CHUNK_SIZE);
+		}
+
+		io_result = io_read(image_handle, image_base + *length_read,
+				    chunk, &bytes_read);
+		if ((io_result != 0) || (bytes_read == 0U)) {
+			break;
+		}
+
+		if (hashing &&
+		    (crypto_mod_hash_update((void *)(image_base + *length_read),
+					    (unsigned int)bytes_read) != 0)) {
+			hashing = false;
+		}
+
+		*length_read += bytes_read;
+	}
+
+	/* Only keep the hash of the whole image */
+	(void)crypto_mod_hash_finish(!hashing || (io_result != 0) ||
+				     (*length_read < image_size));
+
+	return io_result;
+}
+#endif /* IMAGE_HASH_STREAMING */
+
 /*******************************************************************************
  * Internal function to load an image at a specific address given
- * an image ID and extents of free memory.
+ * an image ID and extents of free memory. If 'hash_image' is true and
+ * IMAGE_HASH_STREAMING is enabled, the image is hashed while it is loaded.
  *
  * If the load is successful then the image information is updated.
  *
  * Returns 0 on success, a negative error code otherwise.
  ******************************************************************************/
-static int load_image(unsigned int image_id, image_info_t *image_data)
+static int load_image(unsigned int image_id, image_info_t *image_data,
+		      bool hash_image)
 {
 	uintptr_t dev_handle;
 	uintptr_t image_handle;
@@ -123,7 +184,24 @@ static int load_image(unsigned int image_id, image_info_t *image_data)
 
 	/* We have enough space so load the image now */
 	/* TODO: Consider whether to try to recover/retry a partially successful read */
+#if IMAGE_HASH_STREAMING
+	if (hash_image) {
+		io_result = read_image_hashed(image_handle, image_base,
+					      image_size, &bytes_read);
+	} else {
+		/* Don't keep the hash of an image loaded at the same place */
+		(void)crypto_mod_hash_finish(true);
+		io_result = io_read(image_handle, image_base, image_size,
+				    &bytes_read);
+	}
+#else
+	(void)hash_image;
+#if CRYPTO_HASH_REUSE
+	/* Don't keep the hash of an image loaded at the same place */
+	(void)crypto_mod_hash_finish(true);
+#endif
 	io_result = io_read(image_handle, image_base, image_size, &bytes_read);
+#endif
 	if ((io_result != 0) || (bytes_read < image_size)) {
 		WARN("Failed to load image id=%u (%i)\n", image_id, io_result);
 		goto exit;
@@ -164,8 +242,11 @@ static int load_auth_image_recursive(unsigned int image_id,
 		}
 	}
 
-	/* Load the image */
-	rc = load_image(image_id, image_data);
+	/*
+	 * Load the image. Parent images are certificates, which are not
+	 * authenticated by their hash.
+	 */
+	rc = load_image(image_id, image_data, is_parent_image == 0);
 	if (rc != 0) {
 		return rc;
 	}
@@ -191,12 +272,36 @@ static int load_auth_image_internal(unsigned int image_id,
 				    image_info_t *image_data)
 {
 #if TRUSTED_BOARD_BOOT
+	int rc;
+
 	if (dyn_is_auth_disabled() == 0) {
-		return load_auth_image_recursive(image_id, image_data, 0);
+		rc = load_auth_image_recursive(image_id, image_data, 0);
+#if IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE
+		/*
+		 * Authentication may have failed before the hash of the image
+		 * was verified. Drop the hash computed while loading it, so
+		 * that it is never used to authenticate other data.
+		 */
+		if (rc != 0) {
+			(void)crypto_mod_hash_finish(true);
+		}
+#endif
+#if CRYPTO_HASH_REUSE
+		/*
+		 * Keep the hash which has just authenticated the image, by
+		 * image ID, so that measuring the image doesn't hash it again.
+		 */
+		if (rc == 0) {
+			crypto_mod_image_hash_claim(image_id,
+					(void *)image_data->image_base,
+					image_data->image_size);
+		}
+#endif
+		return rc;
 	}
 #endif
 
-	return load_image(image_id, image_data);
+	return load_image(image_id, image_data, false);
 }
 
 /*******************************************************************************
@@ -218,18 +323,32 @@ int load_auth_image(unsigned int image_id, image_info_t *image_data)
 #if PSA_FWU_SUPPORT
 	err = load_auth_image_internal(image_id, image_data);
 #else
-	do {
+	err = load_auth_image_internal(image_id, image_data);
+	while ((err != 0) && (plat_try_next_boot_source() != 0)) {
+#if TRUSTED_BOARD_BOOT
+		/*
+		 * The certificates authenticated so far, and the keys and
+		 * hashes extracted from them, come from the previous boot
+		 * source. Authenticate those of the new boot source instead.
+		 */
+		auth_mod_clear_authenticated();
+#endif
 		err = load_auth_image_internal(image_id, image_data);
-	} while ((err != 0) && (plat_try_next_boot_source() != 0));
+	}
 #endif /* PSA_FWU_SUPPORT */
 
 	if (err == 0) {
 		/*
 		 * If loading of the image gets passed (along with its
 		 * authentication in case of Trusted-Boot flow) then measure
-		 * it (if MEASURED_BOOT flag is enabled).
+		 * it (if MEASURED_BOOT flag is enabled). The hash computed
+		 * to authenticate the image is used again if possible.
 		 */
 		err = plat_mboot_measure_image(image_id, image_data);
+#if CRYPTO_HASH_REUSE
+		/* Don't keep the hash of the image beyond its measurement */
+		crypto_mod_image_hash_drop();
+#endif
 		if (err != 0) {
 			return err;
 		}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2019, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -25,6 +25,21 @@ uint8_t rt_svc_descs_indices[MAX_RT_SVCS];
 #define RT_SVC_DECS_NUM		((RT_SVC_DESCS_END - RT_SVC_DESCS_START)\
 					/ sizeof(rt_svc_desc_t))
 
+#if RT_SVC_FID_TABLE
+/*******************************************************************************
+ * The 'rt_svc_fid_indices' array is a second level of dispatch for the fast
+ * calls of the Standard Service. It is indexed by the calling convention[30]
+ * bit and the function number[8:0] bits of the function id, and holds the
+ * index of a descriptor in the 'rt_svc_fid_descs' linker section. When there
+ * is one, BL31 calls its handler instead of the Standard Service handler.
+ ******************************************************************************/
+uint8_t rt_svc_fid_indices[RT_SVC_FID_TABLE_SIZE];
+
+#define RT_SVC_FID_DESCS_NUM	((RT_SVC_FID_DESCS_END - \
+				  RT_SVC_FID_DESCS_START) / \
+				 sizeof(rt_svc_fid_desc_t))
+#endif
+
 /*******************************************************************************
  * Function to invoke the registered `handle` corresponding to the smc_fid in
  * AArch32 mode.
@@ -80,6 +95,71 @@ static int32_t validate_rt_svc_desc(const rt_svc_desc_t *desc)
 	return 0;
 }
 
+#if RT_SVC_FID_TABLE
+/*******************************************************************************
+ * Simple routine to sanity check a function ID descriptor before using it
+ ******************************************************************************/
+static int32_t validate_rt_svc_fid_desc(const rt_svc_fid_desc_t *desc)
+{
+	if (desc->handle == NULL)
+		return -EINVAL;
+
+	if (desc->start_fid > desc->end_fid)
+		return -EINVAL;
+
+	/* The range must not straddle both calling conventions */
+	if (!is_rt_svc_fid_table_fid(desc->start_fid) ||
+	    !is_rt_svc_fid_table_fid(desc->end_fid) ||
+	    (GET_SMC_CC(desc->start_fid) != GET_SMC_CC(desc->end_fid)))
+		return -EINVAL;
+
+	return 0;
+}
+
+/*******************************************************************************
+ * This function fills the 'rt_svc_fid_indices' array from the function ID
+ * descriptors. They are only used once the Standard Service has been
+ * successfully initialised, so that its function IDs keep returning SMC_UNK
+ * otherwise.
+ ******************************************************************************/
+static void __init rt_svc_fid_table_init(void)
+{
+	const rt_svc_fid_desc_t *fid_descs;
+	uint8_t std_index;
+	unsigned int index;
+	uint32_t fid, idx;
+
+	std_index = rt_svc_descs_indices[get_unique_oen(OEN_STD_START,
+							SMC_TYPE_FAST)];
+	if (std_index >= RT_SVC_DECS_NUM)
+		return;
+
+	assert((RT_SVC_FID_DESCS_END >= RT_SVC_FID_DESCS_START) &&
+	       (RT_SVC_FID_DESCS_NUM < 128U));
+
+	fid_descs = (const rt_svc_fid_desc_t *) RT_SVC_FID_DESCS_START;
+	for (index = 0U; index < RT_SVC_FID_DESCS_NUM; index++) {
+		const rt_svc_fid_desc_t *desc = &fid_descs[index];
+
+		if (validate_rt_svc_fid_desc(desc) != 0) {
+			ERROR("Invalid function ID descriptor %p\n",
+				(void *) desc);
+			panic();
+		}
+
+		for (fid = desc->start_fid; fid <= desc->end_fid; fid++) {
+			idx = get_rt_svc_fid_index(fid);
+			if (rt_svc_fid_indices[idx] != UINT8_MAX) {
+				ERROR("Function ID 0x%x registered twice\n",
+					fid);
+				panic();
+			}
+			rt_svc_fid_indices[idx] = (uint8_t)index;
+		}
+	}
+}
+#endif /* RT_SVC_FID_TABLE */
+
 /*******************************************************************************
  * This function calls the initialisation routine in the descriptor exported by
  * a runtime service. Once a descriptor has been validated, its start & end
@@ -97,6 +177,11 @@ void __init runtime_svc_init(void)
 	assert((RT_SVC_DESCS_END >= RT_SVC_DESCS_START) &&
 			(RT_SVC_DECS_NUM < MAX_RT_SVCS));
 
+#if RT_SVC_FID_TABLE
+	/* No function ID is dispatched directly until the table is filled */
+	(void)memset(rt_svc_fid_indices, -1, sizeof(rt_svc_fid_indices));
+#endif
+
 	/* If no runtime services are implemented then simply bail out */
 	if (RT_SVC_DECS_NUM == 0U)
 		return;
@@ -151,4 +236,8 @@ void __init runtime_svc_init(void)
 		for (; start_idx <= end_idx; start_idx++)
 			rt_svc_descs_indices[start_idx] = index;
 	}
+
+#if RT_SVC_FID_TABLE
+	rt_svc_fid_table_init();
+#endif
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2022, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2023, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -464,3 +464,17 @@ int auth_mod_verify_img(unsigned int img_id,
 
 	return 0;
 }
+
+/*
+ * Forget which images have been authenticated, so that the parameters
+ * extracted from them are not used to authenticate other images until they are
+ * authenticated again, e.g. after switching to another boot source.
+ */
+void auth_mod_clear_authenticated(void)
+{
+	unsigned int i;
+
+	for (i = 0U; i < MAX_NUMBER_IDS; i++) {
+		auth_img_flags[i] &= ~IMG_FLAG_AUTHENTICATED;
+	}
+}
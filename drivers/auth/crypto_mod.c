@@ -5,6 +5,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include <common/debug.h>
 #include <drivers/auth/crypto_mod.h>
@@ -142,6 +143,135 @@ int crypto_mod_calc_hash(enum crypto_md_algo alg, void *data_ptr,
 #endif /* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
+#if IMAGE_HASH_STREAMING
+/*
+ * Start hashing data while it is loaded
+ *
+ * Parameters:
+ *
+ *   base: address of the data
+ *
+ * Returns CRYPTO_ERR_HASH if the library can't hash data while it is loaded.
+ */
+int crypto_mod_hash_start(void *base)
+{
+	assert(base != NULL);
+
+	if (crypto_lib_desc.hash_start == NULL) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	return crypto_lib_desc.hash_start(base);
+}
+
+/*
+ * Hash the next chunk of data loaded
+ *
+ * Parameters:
+ *
+ *   data_ptr, data_len: data loaded, following the previous chunk
+ */
+int crypto_mod_hash_update(void *data_ptr, unsigned int data_len)
+{
+	assert(data_ptr != NULL);
+	assert(data_len != 0);
+
+	if (crypto_lib_desc.hash_update == NULL) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	return crypto_lib_desc.hash_update(data_ptr, data_len);
+}
+#endif /* IMAGE_HASH_STREAMING */
+
+#if IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE
+/*
+ * Finish hashing data loaded. Unless 'discard' is set, the library uses the
+ * hash when next asked to verify the hash of that data. Otherwise, the library
+ * drops any hash it kept.
+ *
+ * Parameters:
+ *
+ *   discard: drop the hash, e.g. if the data could not be loaded
+ */
+int crypto_mod_hash_finish(bool discard)
+{
+	if (crypto_lib_desc.hash_finish == NULL) {
+		return CRYPTO_SUCCESS;
+	}
+
+	return crypto_lib_desc.hash_finish(discard);
+}
+#endif /* IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE */
+
+#if CRYPTO_HASH_REUSE
+/* Hash of the image last authenticated, kept until it is measured */
+static struct {
+	unsigned int image_id;
+	enum crypto_md_algo alg;
+	bool valid;
+	unsigned char hash[CRYPTO_MD_MAX_SIZE];
+} image_hash;
+
+/*
+ * Keep the hash computed to authenticate an image, for its measurement. This
+ * must be called right after the image has been authenticated, before its
+ * content can change.
+ *
+ * Parameters:
+ *
+ *   image_id: identifier of the image authenticated
+ *   data_ptr, data_len: image authenticated
+ */
+void crypto_mod_image_hash_claim(unsigned int image_id, void *data_ptr,
+				 unsigned int data_len)
+{
+	image_hash.valid = false;
+
+	if (crypto_lib_desc.get_verified_hash == NULL) {
+		return;
+	}
+
+	if (crypto_lib_desc.get_verified_hash(data_ptr, data_len,
+					      &image_hash.alg,
+					      image_hash.hash) == CRYPTO_SUCCESS) {
+		image_hash.image_id = image_id;
+		image_hash.valid = true;
+	}
+}
+
+/* Drop the hash kept by crypto_mod_image_hash_claim() */
+void crypto_mod_image_hash_drop(void)
+{
+	image_hash.valid = false;
+}
+
+/*
+ * Calculate the hash of an image, reusing the hash claimed when it was
+ * authenticated if there is one for the same image and algorithm.
+ *
+ * Parameters:
+ *
+ *   image_id: identifier of the image
+ *   alg: message digest algorithm
+ *   data_ptr, data_len: image to be hashed
+ *   output: resulting hash
+ */
+int crypto_mod_calc_image_hash(unsigned int image_id, enum crypto_md_algo alg,
+			       void *data_ptr, unsigned int data_len,
+			       unsigned char output[CRYPTO_MD_MAX_SIZE])
+{
+	if (image_hash.valid && (image_hash.image_id == image_id) &&
+	    (image_hash.alg == alg)) {
+		image_hash.valid = false;
+		(void)memcpy(output, image_hash.hash, CRYPTO_MD_MAX_SIZE);
+		return CRYPTO_SUCCESS;
+	}
+
+	return crypto_mod_calc_hash(alg, data_ptr, data_len, output);
+}
+#endif /* CRYPTO_HASH_REUSE */
+
 /*
  * Authenticated decryption of data
  *
@@ -5,6 +5,7 @@
  */
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -63,6 +64,171 @@ static void init(void)
 	mbedtls_init();
 }
 
+#if IMAGE_HASH_STREAMING
+/* Images are hashed while they are loaded with the algorithm of the CoT */
+#if TF_MBEDTLS_HASH_ALG_ID == TF_MBEDTLS_SHA512
+#define HASH_STREAM_MD_ALG	MBEDTLS_MD_SHA512
+#elif TF_MBEDTLS_HASH_ALG_ID == TF_MBEDTLS_SHA384
+#define HASH_STREAM_MD_ALG	MBEDTLS_MD_SHA384
+#else
+#define HASH_STREAM_MD_ALG	MBEDTLS_MD_SHA256
+#endif
+
+/* Data being hashed while it is loaded at 'base' */
+static struct {
+	mbedtls_md_context_t ctx;
+	unsigned char *base;
+	size_t len;
+	bool started;
+} hash_stream;
+
+/*
+ * Hash of the image last hashed while it was loaded. It is only used by the
+ * next verify_hash(), which authenticates that image, and is dropped by it.
+ */
+static struct {
+	const unsigned char *base;
+	size_t len;
+	bool valid;
+	unsigned char digest[MBEDTLS_MD_MAX_SIZE];
+} hash_streamed;
+
+/*
+ * Copy the hash of 'data_len' bytes at 'data_ptr' with 'md_alg' to 'output' if
+ * it was computed while loading them. Return true if so. The hash is dropped
+ * in any case.
+ */
+static bool hash_streamed_take(mbedtls_md_type_t md_alg, const void *data_ptr,
+			       size_t data_len, unsigned char *output)
+{
+	bool match = hash_streamed.valid && (md_alg == HASH_STREAM_MD_ALG) &&
+		     ((const unsigned char *)data_ptr == hash_streamed.base) &&
+		     (data_len == hash_streamed.len);
+
+	if (match) {
+		(void)memcpy(output, hash_streamed.digest,
+			     mbedtls_md_get_size(
+				mbedtls_md_info_from_type(md_alg)));
+	}
+
+	hash_streamed.valid = false;
+
+	return match;
+}
+#endif /* IMAGE_HASH_STREAMING */
+
+#if CRYPTO_HASH_REUSE
+/*
+ * Hash of the data last matched by verify_hash(). It is never used to verify
+ * or calculate a hash, only handed once to the caller which authenticated the
+ * data through get_verified_hash(), and dropped by the next verify_hash() or
+ * hash_finish().
+ */
+static struct {
+	const unsigned char *base;
+	size_t len;
+	mbedtls_md_type_t md_alg;
+	bool valid;
+	unsigned char digest[MBEDTLS_MD_MAX_SIZE];
+} hash_verified;
+#endif /* CRYPTO_HASH_REUSE */
+
+#if IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE
+static int hash_finish(bool discard)
+{
+	int rc = 0;
+#if IMAGE_HASH_STREAMING
+	unsigned char digest[MBEDTLS_MD_MAX_SIZE];
+#endif
+
+#if CRYPTO_HASH_REUSE
+	hash_verified.valid = false;
+#endif
+
+#if IMAGE_HASH_STREAMING
+	hash_streamed.valid = false;
+
+	if (hash_stream.started) {
+		if (!discard) {
+			rc = mbedtls_md_finish(&hash_stream.ctx, digest);
+			if (rc == 0) {
+				hash_streamed.base = hash_stream.base;
+				hash_streamed.len = hash_stream.len;
+				(void)memcpy(hash_streamed.digest, digest,
+					     sizeof(digest));
+				hash_streamed.valid = true;
+			}
+		}
+
+		mbedtls_md_free(&hash_stream.ctx);
+		hash_stream.started = false;
+	}
+#else
+	(void)discard;
+#endif /* IMAGE_HASH_STREAMING */
+
+	return (rc == 0) ? CRYPTO_SUCCESS : CRYPTO_ERR_HASH;
+}
+#endif /* IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE */
+
+#if IMAGE_HASH_STREAMING
+static int hash_start(void *base)
+{
+	const mbedtls_md_info_t *md_info;
+
+	(void)hash_finish(true);
+
+	md_info = mbedtls_md_info_from_type(HASH_STREAM_MD_ALG);
+	if (md_info == NULL) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	mbedtls_md_init(&hash_stream.ctx);
+	if ((mbedtls_md_setup(&hash_stream.ctx, md_info, 0) != 0) ||
+	    (mbedtls_md_starts(&hash_stream.ctx) != 0)) {
+		mbedtls_md_free(&hash_stream.ctx);
+		return CRYPTO_ERR_HASH;
+	}
+
+	hash_stream.base = base;
+	hash_stream.len = 0U;
+	hash_stream.started = true;
+
+	return CRYPTO_SUCCESS;
+}
+
+static int hash_update(void *data_ptr, unsigned int data_len)
+{
+	/* The chunks must be hashed in order */
+	if (!hash_stream.started ||
+	    ((unsigned char *)data_ptr != (hash_stream.base + hash_stream.len))) {
+		(void)hash_finish(true);
+		return CRYPTO_ERR_HASH;
+	}
+
+	if (mbedtls_md_update(&hash_stream.ctx, data_ptr, data_len) != 0) {
+		(void)hash_finish(true);
+		return CRYPTO_ERR_HASH;
+	}
+
+	hash_stream.len += data_len;
+
+	return CRYPTO_SUCCESS;
+}
+
+#define HASH_START	hash_start
+#define HASH_UPDATE	hash_update
+#else
+#define HASH_START	NULL
+#define HASH_UPDATE	NULL
+#endif /* IMAGE_HASH_STREAMING */
+
+#if IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE
+#define HASH_FINISH	hash_finish
+#else
+#define HASH_FINISH	NULL
+#endif /* IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE */
+
 #if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY || \
 CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 /*
@@ -171,6 +337,10 @@ static int verify_hash(void *data_ptr, unsigned int data_len,
 	size_t len;
 	int rc;
 
+#if CRYPTO_HASH_REUSE
+	hash_verified.valid = false;
+#endif
+
 	/*
 	 * Digest info should be an MBEDTLS_ASN1_SEQUENCE
 	 * and consume all bytes.
@@ -211,11 +381,16 @@ static int verify_hash(void *data_ptr, unsigned int data_len,
 	}
 	hash = p;
 
-	/* Calculate the hash of the data */
-	p = (unsigned char *)data_ptr;
-	rc = mbedtls_md(md_info, p, data_len, data_hash);
-	if (rc != 0) {
-		return CRYPTO_ERR_HASH;
+	/* Calculate the hash of the data, unless it was hashed while loaded */
+#if IMAGE_HASH_STREAMING
+	if (!hash_streamed_take(md_alg, data_ptr, data_len, data_hash))
+#endif
+	{
+		p = (unsigned char *)data_ptr;
+		rc = mbedtls_md(md_info, p, data_len, data_hash);
+		if (rc != 0) {
+			return CRYPTO_ERR_HASH;
+		}
 	}
 
 	/* Compare values */
@@ -224,6 +399,15 @@ static int verify_hash(void *data_ptr, unsigned int data_len,
 		return CRYPTO_ERR_HASH;
 	}
 
+#if CRYPTO_HASH_REUSE
+	hash_verified.base = data_ptr;
+	hash_verified.len = data_len;
+	hash_verified.md_alg = md_alg;
+	(void)memcpy(hash_verified.digest, data_hash,
+		     mbedtls_md_get_size(md_info));
+	hash_verified.valid = true;
+#endif
+
 	return CRYPTO_SUCCESS;
 }
 #endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY || \
@@ -276,6 +460,55 @@ static int calc_hash(enum crypto_md_algo md_algo, void *data_ptr,
 #endif /* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
+#if CRYPTO_HASH_REUSE
+/*
+ * Get the hash last matched by verify_hash() if it was for the 'data_len'
+ * bytes at 'data_ptr'. The hash is dropped in any case.
+ */
+static int get_verified_hash(void *data_ptr, unsigned int data_len,
+			     enum crypto_md_algo *md_algo,
+			     unsigned char output[CRYPTO_MD_MAX_SIZE])
+{
+	bool match = hash_verified.valid &&
+		     ((const unsigned char *)data_ptr == hash_verified.base) &&
+		     (data_len == hash_verified.len);
+	int rc = CRYPTO_SUCCESS;
+
+	hash_verified.valid = false;
+
+	if (!match) {
+		return CRYPTO_ERR_HASH;
+	}
+
+	switch (hash_verified.md_alg) {
+	case MBEDTLS_MD_SHA512:
+		*md_algo = CRYPTO_MD_SHA512;
+		break;
+	case MBEDTLS_MD_SHA384:
+		*md_algo = CRYPTO_MD_SHA384;
+		break;
+	case MBEDTLS_MD_SHA256:
+		*md_algo = CRYPTO_MD_SHA256;
+		break;
+	default:
+		rc = CRYPTO_ERR_HASH;
+		break;
+	}
+
+	if (rc == CRYPTO_SUCCESS) {
+		(void)memcpy(output, hash_verified.digest,
+			     mbedtls_md_get_size(
+				mbedtls_md_info_from_type(hash_verified.md_alg)));
+	}
+
+	return rc;
+}
+
+#define GET_VERIFIED_HASH	get_verified_hash
+#else
+#define GET_VERIFIED_HASH	NULL
+#endif /* CRYPTO_HASH_REUSE */
+
 #if TF_MBEDTLS_USE_AES_GCM
 /*
  * Stack based buffer allocation for decryption operation. It could
@@ -396,18 +629,22 @@ static int auth_decrypt(enum crypto_dec_algo dec_algo, void *data_ptr,
 #if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 #if TF_MBEDTLS_USE_AES_GCM
 REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, calc_hash,
-		    auth_decrypt);
+		    auth_decrypt, HASH_START, HASH_UPDATE, HASH_FINISH,
+		    GET_VERIFIED_HASH);
 #else
 REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, calc_hash,
-		    NULL);
+		    NULL, HASH_START, HASH_UPDATE, HASH_FINISH,
+		    GET_VERIFIED_HASH);
 #endif
 #elif CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY
 #if TF_MBEDTLS_USE_AES_GCM
 REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash,
-		    auth_decrypt);
+		    auth_decrypt, HASH_START, HASH_UPDATE, HASH_FINISH);
 #else
-REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, NULL);
+REGISTER_CRYPTO_LIB(LIB_NAME, init, verify_signature, verify_hash, NULL,
+		    HASH_START, HASH_UPDATE, HASH_FINISH);
 #endif
 #elif CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY
-REGISTER_CRYPTO_LIB(LIB_NAME, init, calc_hash);
+REGISTER_CRYPTO_LIB(LIB_NAME, init, calc_hash, HASH_START, HASH_UPDATE,
+		    HASH_FINISH);
 #endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
@@ -16,11 +16,30 @@
 #include <drivers/io/io_storage.h>
 #include <lib/utils.h>
 
+/* Maximum number of blocks of io_block_dev_spec_t.cache_blocks */
+#ifndef IO_BLOCK_CACHE_BLOCKS
+#define IO_BLOCK_CACHE_BLOCKS	4U
+#endif
+
+/* Block held in a slot of the read cache. The slot is empty if last_use is 0 */
+typedef struct {
+	int		lba;
+	unsigned int	last_use;
+} block_cache_entry_t;
+
+/*
+ * The last 'cache_blocks' blocks of the device buffer hold the read cache and
+ * the first 'bounce_length' bytes are used to transfer the other data.
+ */
 typedef struct {
 	io_block_dev_spec_t	*dev_spec;
 	uintptr_t		base;
 	unsigned long long	file_pos;
 	unsigned long long	size;
+	size_t			bounce_length;
+	unsigned int		cache_blocks;
+	unsigned int		cache_tick;
+	block_cache_entry_t	cache[IO_BLOCK_CACHE_BLOCKS];
 } block_dev_state_t;
 
 #define is_power_of_2(x)	(((x) != 0U) && (((x) & ((x) - 1U)) == 0U))
@@ -124,6 +143,13 @@ static int free_dev_info(io_dev_info_t *dev_info)
 	return result;
 }
 
+/* Drop all the blocks from the read cache */
+static void block_cache_reset(block_dev_state_t *cur)
+{
+	cur->cache_tick = 0U;
+	zeromem(cur->cache, sizeof(cur->cache));
+}
+
 static int block_open(io_dev_info_t *dev_info, const uintptr_t spec,
 		      io_entity_t *entity)
 {
@@ -143,10 +169,95 @@ static int block_open(io_dev_info_t *dev_info, const uintptr_t spec,
 	cur->size = region->length;
 	cur->file_pos = 0;
 
+	/* The data may have changed underneath since the last open */
+	block_cache_reset(cur);
+
 	entity->info = (uintptr_t)cur;
 	return 0;
 }
 
+/* Return the address of slot 'index' of the read cache in the device buffer */
+static uintptr_t block_cache_slot(const block_dev_state_t *cur,
+				  unsigned int index)
+{
+	return cur->dev_spec->buffer.offset + cur->bounce_length +
+	       ((size_t)index * cur->dev_spec->block_size);
+}
+
+/*
+ * Return the address of a copy of block 'lba' in the read cache. If it is not
+ * cached yet, the block is read into the least recently used slot. Return 0 if
+ * the block can't be read.
+ */
+static uintptr_t block_cache_get(block_dev_state_t *cur, int lba)
+{
+	size_t block_size = cur->dev_spec->block_size;
+	block_cache_entry_t *entry;
+	unsigned int victim = 0U;
+	unsigned int index;
+	uintptr_t slot;
+
+	assert(cur->cache_blocks != 0U);
+
+	/* Forget the cached blocks rather than their order if the tick wraps */
+	if (++cur->cache_tick == 0U) {
+		block_cache_reset(cur);
+		cur->cache_tick = 1U;
+	}
+
+	for (index = 0U; index < cur->cache_blocks; index++) {
+		entry = &cur->cache[index];
+		if ((entry->last_use != 0U) && (entry->lba == lba)) {
+			entry->last_use = cur->cache_tick;
+			return block_cache_slot(cur, index);
+		}
+
+		if (entry->last_use < cur->cache[victim].last_use) {
+			victim = index;
+		}
+	}
+
+	entry = &cur->cache[victim];
+	slot = block_cache_slot(cur, victim);
+
+	entry->last_use = 0U;
+	if (cur->dev_spec->ops.read(lba, slot, block_size) < block_size) {
+		return 0U;
+	}
+
+	entry->lba = lba;
+	entry->last_use = cur->cache_tick;
+
+	return slot;
+}
+
+/* Drop the blocks from 'lba' to 'lba' + 'nr_blocks' - 1 from the read cache */
+static void block_cache_invalidate(block_dev_state_t *cur, int lba,
+				   size_t nr_blocks)
+{
+	block_cache_entry_t *entry;
+	unsigned int index;
+
+	for (index = 0U; index < cur->cache_blocks; index++) {
+		entry = &cur->cache[index];
+		if ((entry->lba >= lba) &&
+		    ((size_t)(entry->lba - lba) < nr_blocks)) {
+			entry->last_use = 0U;
+		}
+	}
+}
+
+/*
+ * Return 1 if whole blocks can be read directly into the caller's buffer at
+ * 'dest', 0 otherwise.
+ */
+static int block_direct_read_ok(const block_dev_state_t *cur, uintptr_t dest)
+{
+	size_t align = cur->dev_spec->direct_align;
+
+	return ((align != 0U) && ((dest & (align - 1U)) == 0U)) ? 1 : 0;
+}
+
 /* parameter offset is relative address at here */
 static int block_seek(io_entity_t *entity, int mode, signed long long offset)
 {
@@ -240,6 +351,18 @@ static int block_seek(io_entity_t *entity, int mode, signed long long offset)
  *
  * Additionally, the IO driver has an underlying buffer that is at least
  * one block-size and may be big enough to allow.
+ *
+ * Two paths avoid going through that buffer as above:
+ *
+ * - If the device allows it (see direct_align), whole blocks are read
+ *   directly into the caller's buffer, with as many blocks per request as
+ *   the low level driver accepts.
+ *
+ * - If the platform enables it (see cache_blocks), the blocks which are
+ *   only partly read, such as the block of a FIP ToC entry or a GPT entry,
+ *   are kept in a small LRU cache at the end of the device buffer, so that
+ *   reading neighbouring data again doesn't access the device. The cache is
+ *   dropped on every open.
  */
 static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 		      size_t *length_read)
@@ -264,6 +387,10 @@ static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 	 */
 	size_t padding;
 
+	/* address in the caller's buffer of the data read in one iteration */
+	uintptr_t dest;
+	uintptr_t cached;
+
 	assert(entity->info != (uintptr_t)NULL);
 	cur = (block_dev_state_t *)entity->info;
 	ops = &(cur->dev_spec->ops);
@@ -296,13 +423,54 @@ static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 		 */
 		lba = (cur->file_pos + cur->base) / block_size;
 
-		if ((skip + left) > buf->length) {
+		dest = buffer + count;
+
+		if ((skip == 0U) && (left >= block_size) &&
+		    (block_direct_read_ok(cur, dest) != 0)) {
+			/* Read whole blocks into the caller's buffer. */
+			request = left & ~(block_size - 1U);
+			nbytes = ops->read(lba, dest, request) &
+				~(block_size - 1U);
+			if (nbytes == 0U) {
+				return -EIO;
+			}
+
+			cur->file_pos += nbytes;
+			count += nbytes;
+			continue;
+		}
+
+		if ((cur->cache_blocks != 0U) &&
+		    (((skip + left) <= block_size) ||
+		     (block_direct_read_ok(cur, dest + block_size - skip) != 0))) {
+			/*
+			 * The data ends in this block, or the next blocks
+			 * can be read directly: go through the cache.
+			 */
+			cached = block_cache_get(cur, lba);
+			if (cached == 0U) {
+				return -EIO;
+			}
+
+			nbytes = block_size - skip;
+			if (nbytes > left) {
+				nbytes = left;
+			}
+
+			memcpy((void *)dest, (void *)(cached + skip), nbytes);
+
+			cur->file_pos += nbytes;
+			count += nbytes;
+			continue;
+		}
+
+		if ((skip + left) > cur->bounce_length) {
 			/*
 			 * The underlying read buffer is too small to
 			 * read all the required data - limit to just
 			 * fill the buffer, and then read again.
 			 */
-			request = buf->length;
+			request = cur->bounce_length;
 		} else {
 			/*
 			 * The underlying read buffer is big enough to
@@ -409,13 +577,13 @@ static int block_write(io_entity_t *entity, const uintptr_t buffer,
 		 */
 		lba = (cur->file_pos + cur->base) / block_size;
 
-		if ((skip + left) > buf->length) {
+		if ((skip + left) > cur->bounce_length) {
 			/*
 			 * The underlying read buffer is too small to
 			 * read all the required data - limit to just
 			 * fill the buffer, and then read again.
 			 */
-			request = buf->length;
+			request = cur->bounce_length;
 		} else {
 			/*
 			 * The underlying read buffer is big enough to
@@ -468,6 +636,9 @@ static int block_write(io_entity_t *entity, const uintptr_t buffer,
 		       (void *)(buffer + count),
 		       nbytes);
 
+		/* Don't keep stale copies of the blocks in the read cache. */
+		block_cache_invalidate(cur, lba, request / block_size);
+
 		request = ops->write(lba, buf->offset, request);
 		if (request <= skip)
 			return -EIO;
@@ -518,11 +689,25 @@ static int block_dev_open(const uintptr_t dev_spec, io_dev_info_t **dev_info)
 	assert((block_size > 0U) &&
 	       (is_power_of_2(block_size) != 0U) &&
 	       ((buffer->offset % block_size) == 0U) &&
-	       ((buffer->length % block_size) == 0U));
+	       ((buffer->length % block_size) == 0U) &&
+	       ((cur->dev_spec->direct_align == 0U) ||
+		(is_power_of_2(cur->dev_spec->direct_align) != 0U)));
+
+	/*
+	 * Use up to half of the device buffer as read cache, so that at least
+	 * one block is left for the other transfers.
+	 */
+	cur->cache_blocks = cur->dev_spec->cache_blocks;
+	if (cur->cache_blocks > ((buffer->length / block_size) / 2U)) {
+		cur->cache_blocks = (buffer->length / block_size) / 2U;
+	}
+	if (cur->cache_blocks > IO_BLOCK_CACHE_BLOCKS) {
+		cur->cache_blocks = IO_BLOCK_CACHE_BLOCKS;
+	}
+	cur->bounce_length = buffer->length - (cur->cache_blocks * block_size);
+	block_cache_reset(cur);
 
 	*dev_info = info;	/* cast away const */
-	(void)block_size;
-	(void)buffer;
 	return 0;
 }
 
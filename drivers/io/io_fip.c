@@ -6,6 +6,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -25,6 +26,16 @@
 #define MAX_FIP_DEVICES		1
 #endif
 
+/* Maximum number of files open at the same time across all FIP devices */
+#ifndef MAX_FIP_FILES
+#define MAX_FIP_FILES		2
+#endif
+
+/* Maximum number of ToC entries indexed per FIP device */
+#ifndef MAX_FIP_TOC_ENTRIES
+#define MAX_FIP_TOC_ENTRIES	32
+#endif
+
 /* Useful for printing UUIDs when debugging.*/
 #define PRINT_UUID2(x)								\
 	"%08x-%04hx-%04hx-%02hhx%02hhx-%02hhx%02hhx%02hhx%02hhx%02hhx%02hhx",	\
@@ -33,32 +44,44 @@
 		x.node[0], x.node[1], x.node[2], x.node[3],			\
 		x.node[4], x.node[5]
 
+/* Location of a file in the package, as indexed from the ToC */
 typedef struct {
-	unsigned int file_pos;
-	fip_toc_entry_t entry;
-} fip_file_state_t;
+	uuid_t uuid;
+	uint64_t offset_address;
+	uint64_t size;
+} fip_toc_index_entry_t;
 
 /*
- * Maintain dev_spec per FIP Device
- * TODO - Add backend handles and file state
- * per FIP device here once backends like io_memmap
- * can support multiple open files
+ * Maintain dev_spec, backend and ToC index per FIP Device.
+ * The ToC is read by each fip_dev_init() into 'toc', sorted by UUID, so that
+ * opening a file does not access the backend. If the ToC has more than
+ * MAX_FIP_TOC_ENTRIES entries, 'toc_truncated' is set and the files that are
+ * not in the index are looked up in the backend.
  */
 typedef struct {
 	uintptr_t dev_spec;
 	uint16_t plat_toc_flag;
+	uintptr_t backend_dev_handle;
+	uintptr_t backend_image_spec;
+	bool toc_valid;
+	bool toc_truncated;
+	unsigned int toc_count;
+	fip_toc_index_entry_t toc[MAX_FIP_TOC_ENTRIES];
 } fip_dev_state_t;
 
 /*
- * Only one file can be open across all FIP device
- * as backends like io_memmap don't support
- * multiple open files. The file state and
- * backend handle should be maintained per FIP device
- * if the same support is available in the backend
+ * The backend is only opened for the duration of each access, so several
+ * files can be open across all FIP devices even with backends like io_memmap
+ * which don't support multiple open files. A file state is free when 'dev' is
+ * NULL.
  */
-static fip_file_state_t current_fip_file = {0};
-static uintptr_t backend_dev_handle;
-static uintptr_t backend_image_spec;
+typedef struct {
+	fip_dev_state_t *dev;
+	unsigned int file_pos;
+	fip_toc_index_entry_t entry;
+} fip_file_state_t;
+
+static fip_file_state_t file_pool[MAX_FIP_FILES];
 
 static fip_dev_state_t state_pool[MAX_FIP_DEVICES];
 static io_dev_info_t dev_info_pool[MAX_FIP_DEVICES];
@@ -183,8 +206,8 @@ static int free_dev_info(io_dev_info_t *dev_info)
 
 /*
  * Multiple FIP devices can be opened depending on the value of
- * MAX_FIP_DEVICES. Given that there is only one backend, only a
- * single file can be open at a time by any FIP device.
+ * MAX_FIP_DEVICES. Up to MAX_FIP_FILES files can be open at a time
+ * across all of them.
  */
 static int fip_dev_open(const uintptr_t dev_spec,
 			 io_dev_info_t **dev_info)
@@ -212,11 +235,150 @@ static int fip_dev_open(const uintptr_t dev_spec,
 }
 
 
-/* Do some basic package checks. */
+/*
+ * Read the ToC of the package opened as 'backend_handle', positioned after the
+ * header, into the index of 'state', sorted by UUID.
+ */
+static int fip_toc_index_build(fip_dev_state_t *state, uintptr_t backend_handle)
+{
+	static const uuid_t uuid_null = { {0} }; /* Double braces for clang */
+	fip_toc_entry_t entry;
+	size_t bytes_read;
+	unsigned int i;
+	int result;
+
+	state->toc_count = 0U;
+	state->toc_truncated = false;
+
+	for (;;) {
+		result = io_read(backend_handle, (uintptr_t)&entry,
+				 sizeof(entry), &bytes_read);
+		if (result != 0) {
+			WARN("Failed to read FIP (%i)\n", result);
+			return result;
+		}
+
+		if (compare_uuids(&entry.uuid, &uuid_null) == 0) {
+			break;
+		}
+
+		if (state->toc_count == (unsigned int)MAX_FIP_TOC_ENTRIES) {
+			VERBOSE("FIP ToC index full\n");
+			state->toc_truncated = true;
+			break;
+		}
+
+		/*
+		 * Insert the entry after those with a lower or equal UUID, so
+		 * that the first of duplicate entries is found first, as when
+		 * scanning the ToC.
+		 */
+		i = state->toc_count;
+		while ((i > 0U) &&
+		       (compare_uuids(&state->toc[i - 1U].uuid,
+				      &entry.uuid) > 0)) {
+			state->toc[i] = state->toc[i - 1U];
+			i--;
+		}
+
+		state->toc[i].uuid = entry.uuid;
+		state->toc[i].offset_address = entry.offset_address;
+		state->toc[i].size = entry.size;
+		state->toc_count++;
+	}
+
+	return 0;
+}
+
+/* Look up a file in the ToC index of a FIP device. */
+static const fip_toc_index_entry_t *fip_toc_index_find(
+		const fip_dev_state_t *state, const uuid_t *uuid)
+{
+	unsigned int low = 0U;
+	unsigned int high = state->toc_count;
+	unsigned int mid;
+
+	/* Find the first entry with a UUID greater than or equal to 'uuid' */
+	while (low < high) {
+		mid = low + ((high - low) / 2U);
+		if (compare_uuids(&state->toc[mid].uuid, uuid) < 0) {
+			low = mid + 1U;
+		} else {
+			high = mid;
+		}
+	}
+
+	if ((low < state->toc_count) &&
+	    (compare_uuids(&state->toc[low].uuid, uuid) == 0)) {
+		return &state->toc[low];
+	}
+
+	return NULL;
+}
+
+/*
+ * Look up a file which is not in the ToC index of a FIP device by scanning the
+ * ToC in the backend, past the indexed entries.
+ */
+static int fip_toc_scan(const fip_dev_state_t *state, const uuid_t *uuid,
+			fip_toc_index_entry_t *found)
+{
+	static const uuid_t uuid_null = { {0} }; /* Double braces for clang */
+	uintptr_t backend_handle;
+	fip_toc_entry_t entry;
+	size_t bytes_read;
+	int result;
+
+	result = io_open(state->backend_dev_handle, state->backend_image_spec,
+			 &backend_handle);
+	if (result != 0) {
+		WARN("Failed to open Firmware Image Package (%i)\n", result);
+		return -ENOENT;
+	}
+
+	result = io_seek(backend_handle, IO_SEEK_SET,
+			 (signed long long)(sizeof(fip_toc_header_t) +
+			 (MAX_FIP_TOC_ENTRIES * sizeof(fip_toc_entry_t))));
+	if (result != 0) {
+		WARN("fip_file_open: failed to seek\n");
+		result = -ENOENT;
+		goto fip_toc_scan_close;
+	}
+
+	do {
+		result = io_read(backend_handle, (uintptr_t)&entry,
+				 sizeof(entry), &bytes_read);
+		if (result != 0) {
+			WARN("Failed to read FIP (%i)\n", result);
+			goto fip_toc_scan_close;
+		}
+
+		if (compare_uuids(&entry.uuid, uuid) == 0) {
+			found->uuid = entry.uuid;
+			found->offset_address = entry.offset_address;
+			found->size = entry.size;
+			goto fip_toc_scan_close;
+		}
+	} while (compare_uuids(&entry.uuid, &uuid_null) != 0);
+
+	result = -ENOENT;
+
+ fip_toc_scan_close:
+	io_close(backend_handle);
+
+	return result;
+}
+
+/*
+ * Do some basic package checks and index its ToC. The index is rebuilt on every
+ * call, as the platform may have designated another package since the last one.
+ */
 static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 {
 	int result;
 	unsigned int image_id = (unsigned int)init_params;
+	uintptr_t backend_dev_handle;
+	uintptr_t backend_image_spec;
 	uintptr_t backend_handle;
 	fip_toc_header_t header;
 	size_t bytes_read;
@@ -236,6 +398,10 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 		goto fip_dev_init_exit;
 	}
 
+	state->toc_valid = false;
+	state->backend_dev_handle = backend_dev_handle;
+	state->backend_image_spec = backend_image_spec;
+
 	/* Attempt to access the FIP image */
 	result = io_open(backend_dev_handle, backend_image_spec,
 			 &backend_handle);
@@ -258,6 +424,13 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 			 * bits [32-47] in fip header.
 			 */
 			state->plat_toc_flag = (header.flags >> 32) & 0xffff;
+
+			result = fip_toc_index_build(state, backend_handle);
+			if (result == 0) {
+				state->toc_valid = true;
+			} else {
+				result = -ENOENT;
+			}
 		}
 	}
 
@@ -272,10 +445,7 @@ static int fip_dev_close(io_dev_info_t *dev_info)
 {
 	/* TODO: Consider tracking open files and cleaning them up here */
 
-	/* Clear the backend. */
-	backend_dev_handle = (uintptr_t)NULL;
-	backend_image_spec = (uintptr_t)NULL;
-
+	/* free_dev_info() clears the backend and the ToC index. */
 	return free_dev_info(dev_info);
 }
 
@@ -285,81 +455,59 @@ static int fip_file_open(io_dev_info_t *dev_info, const uintptr_t spec,
 			 io_entity_t *entity)
 {
 	int result;
-	uintptr_t backend_handle;
 	const io_uuid_spec_t *uuid_spec = (io_uuid_spec_t *)spec;
-	static const uuid_t uuid_null = { {0} }; /* Double braces for clang */
-	size_t bytes_read;
-	int found_file = 0;
+	const fip_toc_index_entry_t *toc_entry;
+	fip_toc_index_entry_t scanned_entry;
+	fip_dev_state_t *state;
+	fip_file_state_t *fp = NULL;
+	unsigned int index;
 
+	assert(dev_info != NULL);
 	assert(uuid_spec != NULL);
 	assert(entity != NULL);
 
-	/* Can only have one file open at a time for the moment. We need to
-	 * track state like file cursor position. We know the header lives at
-	 * offset zero, so this entry should never be zero for an active file.
-	 * When the system supports dynamic memory allocation we can allow more
-	 * than one open file at a time if needed.
-	 */
-	if (current_fip_file.entry.offset_address != 0U) {
-		WARN("fip_file_open : Only one open file at a time.\n");
-		return -ENFILE;
+	state = (fip_dev_state_t *)dev_info->info;
+	if (!state->toc_valid) {
+		WARN("fip_file_open: FIP device not initialised\n");
+		return -ENOENT;
 	}
 
-	/* Attempt to access the FIP image */
-	result = io_open(backend_dev_handle, backend_image_spec,
-			 &backend_handle);
-	if (result != 0) {
-		WARN("Failed to open Firmware Image Package (%i)\n", result);
-		result = -ENOENT;
-		goto fip_file_open_exit;
+	for (index = 0U; index < (unsigned int)MAX_FIP_FILES; index++) {
+		if (file_pool[index].dev == NULL) {
+			fp = &file_pool[index];
+			break;
+		}
 	}
 
-	/* Seek past the FIP header into the Table of Contents */
-	result = io_seek(backend_handle, IO_SEEK_SET,
-			 (signed long long)sizeof(fip_toc_header_t));
-	if (result != 0) {
-		WARN("fip_file_open: failed to seek\n");
-		result = -ENOENT;
-		goto fip_file_open_close;
+	if (fp == NULL) {
+		WARN("fip_file_open : Too many open files.\n");
+		return -ENFILE;
 	}
 
-	found_file = 0;
-	do {
-		result = io_read(backend_handle,
-				 (uintptr_t)&current_fip_file.entry,
-				 sizeof(current_fip_file.entry),
-				 &bytes_read);
-		if (result == 0) {
-			if (compare_uuids(&current_fip_file.entry.uuid,
-					  &uuid_spec->uuid) == 0) {
-				found_file = 1;
-			}
-		} else {
-			WARN("Failed to read FIP (%i)\n", result);
-			goto fip_file_open_close;
+	toc_entry = fip_toc_index_find(state, &uuid_spec->uuid);
+	if ((toc_entry == NULL) && state->toc_truncated) {
+		result = fip_toc_scan(state, &uuid_spec->uuid, &scanned_entry);
+		if (result != 0) {
+			return result;
 		}
-	} while ((found_file == 0) &&
-			(compare_uuids(&current_fip_file.entry.uuid,
-				&uuid_null) != 0));
-
-	if (found_file == 1) {
-		/* All fine. Update entity info with file state and return. Set
-		 * the file position to 0. The 'current_fip_file.entry' holds
-		 * the base and size of the file.
-		 */
-		current_fip_file.file_pos = 0;
-		entity->info = (uintptr_t)&current_fip_file;
-	} else {
+		toc_entry = &scanned_entry;
+	}
+
+	if (toc_entry == NULL) {
 		/* Did not find the file in the FIP. */
-		current_fip_file.entry.offset_address = 0;
-		result = -ENOENT;
+		return -ENOENT;
 	}
 
- fip_file_open_close:
-	io_close(backend_handle);
+	/*
+	 * All fine. Update entity info with file state and return. Set the
+	 * file position to 0. The 'entry' holds the base and size of the file.
+	 */
+	fp->dev = state;
+	fp->file_pos = 0U;
+	fp->entry = *toc_entry;
+	entity->info = (uintptr_t)fp;
 
- fip_file_open_exit:
-	return result;
+	return 0;
 }
 
 
@@ -389,17 +537,17 @@ static int fip_file_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 	assert(length_read != NULL);
 	assert(entity->info != (uintptr_t)NULL);
 
+	fp = (fip_file_state_t *)entity->info;
+
 	/* Open the backend, attempt to access the blob image */
-	result = io_open(backend_dev_handle, backend_image_spec,
-			 &backend_handle);
+	result = io_open(fp->dev->backend_dev_handle,
+			 fp->dev->backend_image_spec, &backend_handle);
 	if (result != 0) {
 		WARN("Failed to open FIP (%i)\n", result);
 		result = -ENOENT;
 		goto fip_file_read_exit;
 	}
 
-	fp = (fip_file_state_t *)entity->info;
-
 	/* Seek to the position in the FIP where the payload lives */
 	file_offset = fp->entry.offset_address + fp->file_pos;
 	result = io_seek(backend_handle, IO_SEEK_SET,
@@ -434,11 +582,11 @@ static int fip_file_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 /* Close a file in package */
 static int fip_file_close(io_entity_t *entity)
 {
-	/* Clear our current file pointer.
-	 * If we had malloc() we would free() here.
-	 */
-	if (current_fip_file.entry.offset_address != 0U) {
-		zeromem(&current_fip_file, sizeof(current_fip_file));
+	assert(entity != NULL);
+
+	/* Release the file state to the pool. */
+	if (entity->info != 0U) {
+		zeromem((void *)entity->info, sizeof(fip_file_state_t));
 	}
 
 	/* Clear the Entity info. */
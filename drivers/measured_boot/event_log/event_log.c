@@ -289,7 +289,14 @@ int event_log_measure_and_record(uintptr_t data_base, uint32_t data_size,
 	assert(metadata_ptr->id != EVLOG_INVALID_ID);
 
 	/* Measure the payload with algorithm selected by EventLog driver */
+#if CRYPTO_HASH_REUSE
+	/* Reuse the hash which has just authenticated the image, if any */
+	rc = crypto_mod_calc_image_hash(data_id, CRYPTO_MD_ID,
+					(void *)data_base, data_size,
+					hash_data);
+#else
 	rc = event_log_measure(data_base, data_size, hash_data);
+#endif
 	if (rc != 0) {
 		return rc;
 	}
@@ -78,8 +78,15 @@ int rss_mboot_measure_and_record(uintptr_t data_base, uint32_t data_size,
 	}
 
 	/* Calculate hash */
+#if CRYPTO_HASH_REUSE
+	/* Reuse the hash which has just authenticated the image, if any */
+	rc = crypto_mod_calc_image_hash(data_id, CRYPTO_MD_ID,
+					(void *)data_base, data_size,
+					hash_data);
+#else
 	rc = crypto_mod_calc_hash(CRYPTO_MD_ID,
 				  (void *)data_base, data_size, hash_data);
+#endif
 	if (rc != 0) {
 		return rc;
 	}
@@ -944,6 +944,28 @@
 #define TLBI_ADDR_MASK		ULL(0x00000FFFFFFFFFFF)
 #define TLBI_ADDR(x)		(((x) >> TLBI_ADDR_SHIFT) & TLBI_ADDR_MASK)
 
+/* Xt operand fields of the TLBI RPALOS/RPAOS range invalidation by PA */
+#define TLBI_RPA_BADDR_SHIFT	U(12)
+#define TLBI_RPA_BADDR_MASK	ULL(0xFFFFFFFFFF)
+#define TLBI_RPA_SIZE_SHIFT	U(44)
+#define TLBI_RPA_SIZE_MASK	ULL(0xF)
+#define TLBI_RPA(_pa, _sz)	((((_sz) & TLBI_RPA_SIZE_MASK) <<	\
+				 TLBI_RPA_SIZE_SHIFT) |			\
+				 (((_pa) >> TLBI_RPA_BADDR_SHIFT) &	\
+				 TLBI_RPA_BADDR_MASK))
+
+/* TLBI RPA* SIZE field encodings */
+#define TLBI_RPA_SZ_4KB		U(0x0)
+#define TLBI_RPA_SZ_16KB	U(0x1)
+#define TLBI_RPA_SZ_64KB	U(0x2)
+#define TLBI_RPA_SZ_2MB		U(0x3)
+#define TLBI_RPA_SZ_32MB	U(0x4)
+#define TLBI_RPA_SZ_512MB	U(0x5)
+#define TLBI_RPA_SZ_1GB		U(0x6)
+#define TLBI_RPA_SZ_16GB	U(0x7)
+#define TLBI_RPA_SZ_64GB	U(0x8)
+#define TLBI_RPA_SZ_512GB	U(0x9)
+
 /*******************************************************************************
  * Definitions of register offsets and fields in the CNTCTLBase Frame of the
  * system level implementation of the Generic Timer.
@@ -670,13 +670,16 @@ static inline void tlbipaallos(void)
 }
 
 /*
- * Invalidate TLBs of GPT entries by Physical address, last level.
+ * TLBIRPALOS instruction
+ * (TLB Range Invalidate GPT Information by PA,
+ * Last level, Outer Shareable)
  *
- * @pa: the starting address for the range
- *      of invalidation
- * @size: size of the range of invalidation
+ * @xt: range operand, see TLBI_RPA()
  */
-void gpt_tlbi_by_pa_ll(uint64_t pa, size_t size);
+static inline void tlbirpalos(uint64_t xt)
+{
+	__asm__("SYS #6,c8,c4,#7,%0" : : "r" (xt));
+}
 
 
 /* Previously defined accessor functions with incomplete register names  */
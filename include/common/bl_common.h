@@ -81,6 +81,10 @@
 #define __RODATA_END__			Load$$__RODATA_EPILOGUE__$$Base
 #define __RT_SVC_DESCS_START__		Load$$__RT_SVC_DESCS__$$Base
 #define __RT_SVC_DESCS_END__		Load$$__RT_SVC_DESCS__$$Limit
+#if RT_SVC_FID_TABLE
+#define __RT_SVC_FID_DESCS_START__	Load$$__RT_SVC_FID_DESCS__$$Base
+#define __RT_SVC_FID_DESCS_END__	Load$$__RT_SVC_FID_DESCS__$$Limit
+#endif
 #if SPMC_AT_EL3
 #define __EL3_LP_DESCS_START__		Load$$__EL3_LP_DESCS__$$Base
 #define __EL3_LP_DESCS_END__		Load$$__EL3_LP_DESCS__$$Limit
@@ -33,11 +33,22 @@
 	KEEP(*(.img_parser_lib_descs))			\
 	__PARSER_LIB_DESCS_END__ = .;
 
+#if RT_SVC_FID_TABLE
+#define RT_SVC_FID_DESCS				\
+	. = ALIGN(STRUCT_ALIGN);			\
+	__RT_SVC_FID_DESCS_START__ = .;			\
+	KEEP(*(.rt_svc_fid_descs))			\
+	__RT_SVC_FID_DESCS_END__ = .;
+#else
+#define RT_SVC_FID_DESCS
+#endif
+
 #define RT_SVC_DESCS					\
 	. = ALIGN(STRUCT_ALIGN);			\
 	__RT_SVC_DESCS_START__ = .;			\
 	KEEP(*(.rt_svc_descs))				\
-	__RT_SVC_DESCS_END__ = .;
+	__RT_SVC_DESCS_END__ = .;			\
+	RT_SVC_FID_DESCS
 
 #if SPMC_AT_EL3
 #define EL3_LP_DESCS					\
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2019, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -31,6 +31,24 @@
 #endif /* __aarch64__ */
 #define SIZEOF_RT_SVC_DESC	(U(1) << RT_SVC_SIZE_LOG2)
 
+#if RT_SVC_FID_TABLE
+/*
+ * Constants to allow the assembler access a function ID descriptor and the
+ * table of function ID descriptor indices. The table covers the fast calls of
+ * the Standard Service with a function number below 512, for both calling
+ * conventions.
+ */
+#define RT_SVC_FID_SIZE_LOG2	U(4)
+#define RT_SVC_FID_DESC_HANDLE	U(8)
+#define SIZEOF_RT_SVC_FID_DESC	(U(1) << RT_SVC_FID_SIZE_LOG2)
+
+#define RT_SVC_FID_NUM_WIDTH	U(9)
+#define RT_SVC_FID_TABLE_SIZE	(U(1) << (RT_SVC_FID_NUM_WIDTH + U(1)))
+
+/* Function ID bits above the function number, calling convention excluded */
+#define RT_SVC_FID_STD_FAST	((SMC_TYPE_FAST << FUNCID_TYPE_SHIFT) | \
+				 (OEN_STD_START << FUNCID_OEN_SHIFT))
+#endif /* RT_SVC_FID_TABLE */
 
 /*
  * In SMCCC 1.X, the function identifier has 6 bits for the owning entity number
@@ -81,6 +99,20 @@ typedef struct rt_svc_desc {
 			.handle = (_smch)				\
 		}
 
+/*
+ * Convenience macro for SMC handlers to clear the top 32 bits of the first
+ * four parameters of a 32-bit SMC function, which the caller may leave set.
+ */
+#define SMC32_CLEAR_PARAMS_TOP_BITS(_fid, _x1, _x2, _x3, _x4)		\
+	do {								\
+		if (GET_SMC_CC(_fid) == SMC_32) {			\
+			(_x1) &= UINT32_MAX;				\
+			(_x2) &= UINT32_MAX;				\
+			(_x3) &= UINT32_MAX;				\
+			(_x4) &= UINT32_MAX;				\
+		}							\
+	} while (false)
+
 /*
  * Compile time assertions related to the 'rt_svc_desc' structure to:
  * 1. ensure that the assembler and the compiler view of the size
@@ -97,6 +129,58 @@ CASSERT(RT_SVC_DESC_INIT == __builtin_offsetof(rt_svc_desc_t, init),
 CASSERT(RT_SVC_DESC_HANDLE == __builtin_offsetof(rt_svc_desc_t, handle),
 	assert_rt_svc_desc_handle_offset_mismatch);
 
+#if RT_SVC_FID_TABLE
+/*
+ * A function ID descriptor registers a handler for a range of fast call
+ * function IDs of the Standard Service. BL31 calls it directly, ahead of the
+ * handler of the Standard Service itself, which must not be relied on for any
+ * checks or argument masking.
+ */
+typedef struct rt_svc_fid_desc {
+	uint32_t start_fid;
+	uint32_t end_fid;
+	rt_svc_handle_t handle;
+} rt_svc_fid_desc_t;
+
+/*
+ * Convenience macro to declare a function ID descriptor
+ */
+#define DECLARE_RT_SVC_FIDS(_name, _start, _end, _smch)			\
+	static const rt_svc_fid_desc_t __svc_fid_desc_ ## _name		\
+		__section(".rt_svc_fid_descs") __used = {		\
+			.start_fid = (_start),				\
+			.end_fid = (_end),				\
+			.handle = (_smch)				\
+		}
+
+CASSERT((sizeof(rt_svc_fid_desc_t) == SIZEOF_RT_SVC_FID_DESC),
+	assert_sizeof_rt_svc_fid_desc_mismatch);
+CASSERT(RT_SVC_FID_DESC_HANDLE ==
+	__builtin_offsetof(rt_svc_fid_desc_t, handle),
+	assert_rt_svc_fid_desc_handle_offset_mismatch);
+
+/*
+ * This function tells whether a function ID can be dispatched through the
+ * 'rt_svc_fid_indices' array, in the same way as the BL31 entry code.
+ */
+static inline bool is_rt_svc_fid_table_fid(uint32_t fid)
+{
+	return ((fid & ~(FUNCID_CC_MASK << FUNCID_CC_SHIFT)) >>
+		RT_SVC_FID_NUM_WIDTH) ==
+		(RT_SVC_FID_STD_FAST >> RT_SVC_FID_NUM_WIDTH);
+}
+
+/*
+ * This function generates the index of a function ID in the
+ * 'rt_svc_fid_indices' array from its calling convention and function number.
+ */
+static inline uint32_t get_rt_svc_fid_index(uint32_t fid)
+{
+	return (GET_SMC_CC(fid) << RT_SVC_FID_NUM_WIDTH) |
+		(GET_SMC_NUM(fid) & ((U(1) << RT_SVC_FID_NUM_WIDTH) - U(1)));
+}
+#endif /* RT_SVC_FID_TABLE */
+
 
 /*
  * This function combines the call type and the owning entity number
@@ -130,9 +214,16 @@ uintptr_t handle_runtime_svc(uint32_t smc_fid, void *cookie, void *handle,
 						unsigned int flags);
 IMPORT_SYM(uintptr_t, __RT_SVC_DESCS_START__,		RT_SVC_DESCS_START);
 IMPORT_SYM(uintptr_t, __RT_SVC_DESCS_END__,		RT_SVC_DESCS_END);
+#if RT_SVC_FID_TABLE
+IMPORT_SYM(uintptr_t, __RT_SVC_FID_DESCS_START__,	RT_SVC_FID_DESCS_START);
+IMPORT_SYM(uintptr_t, __RT_SVC_FID_DESCS_END__,		RT_SVC_FID_DESCS_END);
+#endif
 void init_crash_reporting(void);
 
 extern uint8_t rt_svc_descs_indices[MAX_RT_SVCS];
+#if RT_SVC_FID_TABLE
+extern uint8_t rt_svc_fid_indices[RT_SVC_FID_TABLE_SIZE];
+#endif
 
 #endif /*__ASSEMBLER__*/
 #endif /* RUNTIME_SVC_H */
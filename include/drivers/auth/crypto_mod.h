@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2022, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2023, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -7,6 +7,8 @@
 #ifndef CRYPTO_MOD_H
 #define CRYPTO_MOD_H
 
+#include <stdbool.h>
+
 #define	CRYPTO_AUTH_VERIFY_ONLY			1
 #define	CRYPTO_HASH_CALC_ONLY			2
 #define	CRYPTO_AUTH_VERIFY_AND_HASH_CALC	3
@@ -39,6 +41,15 @@ enum crypto_md_algo {
 /* Maximum size as per the known stronger hash algorithm i.e.SHA512 */
 #define CRYPTO_MD_MAX_SIZE		64U
 
+/*
+ * The hash computed to authenticate an image is handed to its measurement, so
+ * that the image is not hashed again. It is claimed by image ID right after
+ * the image is authenticated, see crypto_mod_image_hash_claim(), and is never
+ * looked up by address.
+ */
+#define CRYPTO_HASH_REUSE	((CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC) && \
+				 MEASURED_BOOT)
+
 /*
  * Cryptographic library descriptor
  */
@@ -74,6 +85,18 @@ CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 #endif /* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
+#if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
+	/*
+	 * Get the hash computed by the last verify_hash() call and its
+	 * algorithm, if that call matched the hash of the 'data_len' bytes at
+	 * 'data_ptr'. The hash is dropped in any case. Optional. Return one of
+	 * the 'enum crypto_ret_value' options.
+	 */
+	int (*get_verified_hash)(void *data_ptr, unsigned int data_len,
+				 enum crypto_md_algo *md_alg,
+				 unsigned char output[CRYPTO_MD_MAX_SIZE]);
+#endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
+
 	/*
 	 * Authenticated decryption. Return one of the
 	 * 'enum crypto_ret_value' options.
@@ -83,6 +106,16 @@ CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 			    unsigned int key_flags, const void *iv,
 			    unsigned int iv_len, const void *tag,
 			    unsigned int tag_len);
+
+	/*
+	 * Hash data while it is loaded, one chunk after the other from 'base',
+	 * so that verifying the hash of the data doesn't need to read it again.
+	 * hash_finish() also drops any hash kept for get_verified_hash().
+	 * Optional. Return one of the 'enum crypto_ret_value' options.
+	 */
+	int (*hash_start)(void *base);
+	int (*hash_update)(void *data_ptr, unsigned int data_len);
+	int (*hash_finish)(bool discard);
 } crypto_lib_desc_t;
 
 /* Public functions */
@@ -111,6 +144,15 @@ int crypto_mod_auth_decrypt(enum crypto_dec_algo dec_algo, void *data_ptr,
 			    unsigned int iv_len, const void *tag,
 			    unsigned int tag_len);
 
+#if IMAGE_HASH_STREAMING
+int crypto_mod_hash_start(void *base);
+int crypto_mod_hash_update(void *data_ptr, unsigned int data_len);
+#endif /* IMAGE_HASH_STREAMING */
+
+#if IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE
+int crypto_mod_hash_finish(bool discard);
+#endif /* IMAGE_HASH_STREAMING || CRYPTO_HASH_REUSE */
+
 #if CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 int crypto_mod_calc_hash(enum crypto_md_algo alg, void *data_ptr,
@@ -119,34 +161,56 @@ int crypto_mod_calc_hash(enum crypto_md_algo alg, void *data_ptr,
 #endif /* CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY || \
 	  CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
+#if CRYPTO_HASH_REUSE
+void crypto_mod_image_hash_claim(unsigned int image_id, void *data_ptr,
+				 unsigned int data_len);
+void crypto_mod_image_hash_drop(void);
+int crypto_mod_calc_image_hash(unsigned int image_id, enum crypto_md_algo alg,
+			       void *data_ptr, unsigned int data_len,
+			       unsigned char output[CRYPTO_MD_MAX_SIZE]);
+#endif /* CRYPTO_HASH_REUSE */
+
 #if CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC
 /* Macro to register a cryptographic library */
 #define REGISTER_CRYPTO_LIB(_name, _init, _verify_signature, _verify_hash, \
-			    _calc_hash, _auth_decrypt) \
+			    _calc_hash, _auth_decrypt, _hash_start, \
+			    _hash_update, _hash_finish, _get_verified_hash) \
 	const crypto_lib_desc_t crypto_lib_desc = { \
 		.name = _name, \
 		.init = _init, \
 		.verify_signature = _verify_signature, \
 		.verify_hash = _verify_hash, \
 		.calc_hash = _calc_hash, \
-		.auth_decrypt = _auth_decrypt \
+		.get_verified_hash = _get_verified_hash, \
+		.auth_decrypt = _auth_decrypt, \
+		.hash_start = _hash_start, \
+		.hash_update = _hash_update, \
+		.hash_finish = _hash_finish \
 	}
 #elif CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_ONLY
 #define REGISTER_CRYPTO_LIB(_name, _init, _verify_signature, _verify_hash, \
-			    _auth_decrypt) \
+			    _auth_decrypt, _hash_start, _hash_update, \
+			    _hash_finish) \
 	const crypto_lib_desc_t crypto_lib_desc = { \
 		.name = _name, \
 		.init = _init, \
 		.verify_signature = _verify_signature, \
 		.verify_hash = _verify_hash, \
-		.auth_decrypt = _auth_decrypt \
+		.auth_decrypt = _auth_decrypt, \
+		.hash_start = _hash_start, \
+		.hash_update = _hash_update, \
+		.hash_finish = _hash_finish \
 	}
 #elif CRYPTO_SUPPORT == CRYPTO_HASH_CALC_ONLY
-#define REGISTER_CRYPTO_LIB(_name, _init, _calc_hash) \
+#define REGISTER_CRYPTO_LIB(_name, _init, _calc_hash, _hash_start, \
+			    _hash_update, _hash_finish) \
 	const crypto_lib_desc_t crypto_lib_desc = { \
 		.name = _name, \
 		.init = _init, \
 		.calc_hash = _calc_hash, \
+		.hash_start = _hash_start, \
+		.hash_update = _hash_update, \
+		.hash_finish = _hash_finish \
 	}
 #endif /* CRYPTO_SUPPORT == CRYPTO_AUTH_VERIFY_AND_HASH_CALC */
 
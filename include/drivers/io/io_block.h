@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -19,6 +19,21 @@ typedef struct io_block_dev_spec {
 	io_block_spec_t	buffer;
 	io_block_ops_t	ops;
 	size_t		block_size;
+	/*
+	 * Alignment of the destination that ops.read requires to read whole
+	 * blocks directly into the caller's buffer, a power of 2. If 0, all
+	 * the data is read through 'buffer'.
+	 */
+	size_t		direct_align;
+	/*
+	 * Number of blocks at the end of 'buffer' used to cache the blocks
+	 * which are only partly read, capped to IO_BLOCK_CACHE_BLOCKS and to
+	 * half of 'buffer'. If 0, nothing is cached. The cache is dropped on
+	 * every open of the device or of a region of it, so a platform which
+	 * changes the data underneath io_block, for example by switching the
+	 * eMMC partition, must not read through a handle opened before.
+	 */
+	unsigned int	cache_blocks;
 } io_block_dev_spec_t;
 
 struct io_dev_connector;
@@ -73,6 +73,14 @@
 #define EP_GET_FIRST_EXE(x)	((x) & EP_FIRST_EXE_MASK)
 #define EP_SET_FIRST_EXE(x, ee)	((x) = ((x) & ~EP_FIRST_EXE_MASK) | (ee))
 
+/* Allow the FP registers of the context to be switched lazily. */
+#define EP_FPREGS_LAZY_MASK	U(0x40)
+#define EP_FPREGS_LAZY_SHIFT	U(6)
+#define EP_FPREGS_EAGER		U(0x0)
+#define EP_FPREGS_LAZY		U(0x40)
+#define EP_GET_FPREGS_LAZY(x)	((x) & EP_FPREGS_LAZY_MASK)
+#define EP_SET_FPREGS_LAZY(x, ee)	((x) = ((x) & ~EP_FPREGS_LAZY_MASK) | (ee))
+
 #ifndef __ASSEMBLER__
 
 typedef struct aapcs64_params {
@@ -40,6 +40,7 @@ void cm_prepare_el3_exit_ns(void);
 #if CTX_INCLUDE_EL2_REGS
 void cm_el2_sysregs_context_save(uint32_t security_state);
 void cm_el2_sysregs_context_restore(uint32_t security_state);
+void cm_el2_sysregs_context_switch(uint32_t src_state, uint32_t dst_state);
 #endif
 
 void cm_el1_sysregs_context_save(uint32_t security_state);
@@ -53,6 +54,12 @@ void cm_write_scr_el3_bit(uint32_t security_state,
 void cm_set_next_eret_context(uint32_t security_state);
 u_register_t cm_get_scr_el3(uint32_t security_state);
 
+#if CTX_LAZY_FPREGS
+int cm_handle_fpregs_trap(cpu_context_t *ctx);
+void cm_fpregs_lazy_flush(void);
+void cm_fpregs_lazy_release(cpu_context_t *ctx);
+#endif
+
 /* Inline definitions */
 
 /*******************************************************************************
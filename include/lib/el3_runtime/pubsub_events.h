@@ -24,6 +24,11 @@ REGISTER_PUBSUB_EVENT(psci_cpu_on_finish);
 REGISTER_PUBSUB_EVENT(psci_suspend_pwrdown_start);
 REGISTER_PUBSUB_EVENT(psci_suspend_pwrdown_finish);
 
+/*
+ * Event published after a boot measurement has been extended at runtime.
+ */
+REGISTER_PUBSUB_EVENT(measurement_extended);
+
 #ifdef __aarch64__
 /*
  * These events are published by the AArch64 context management framework
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2023, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef EL3_TRACE_H
+#define EL3_TRACE_H
+
+#include <lib/utils_def.h>
+
+/* Event IDs, the meaning of the arguments follows each event */
+#define EL3_TRACE_WORLD_SWITCH		U(1)	/* security state, context */
+#define EL3_TRACE_GPT_DELEGATE		U(2)	/* base, size, target GPI */
+#define EL3_TRACE_GPT_UNDELEGATE	U(3)	/* base, size, source GPI */
+#define EL3_TRACE_PSCI_CPU_ON		U(4)	/* target MPIDR, entry point */
+#define EL3_TRACE_PSCI_CPU_OFF		U(5)	/* end power level */
+#define EL3_TRACE_PSCI_CPU_SUSPEND	U(6)	/* end power level, power down */
+#define EL3_TRACE_PSCI_WAKEUP		U(7)	/* end power level */
+#define EL3_TRACE_INTR			U(8)	/* type, SCR_EL3, ELR_EL3 */
+
+/* EL3 trace version returned through the SMC interface */
+#define EL3_TRACE_VERSION		U(0x1)
+
+/* Function ID for accessing the EL3 trace interface, SMC64 only */
+#define EL3_TRACE_FID_VALUE		U(0x40)
+
+#define is_el3_trace_fid(_fid)	\
+	(((_fid) & FUNCID_NUM_MASK) == EL3_TRACE_FID_VALUE)
+
+/* Commands passed in x1 */
+#define EL3_TRACE_CMD_VERSION		U(0)
+#define EL3_TRACE_CMD_INIT		U(1)
+#define EL3_TRACE_CMD_DRAIN		U(2)
+
+/* Error codes for EL3 trace SMC interface failures */
+#define EL3_TRACE_E_INVALID_PARAMS	(-2)
+#define EL3_TRACE_E_DENIED		(-3)
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+#include <arch_helpers.h>
+
+/*
+ * Trace record, as stored in the per-CPU rings and copied to the buffer shared
+ * with the Non-secure world. 'seq' is the position of the record in the ring
+ * of its CPU, plus one.
+ */
+typedef struct el3_trace_record {
+	uint64_t seq;
+	uint64_t timestamp;
+	uint32_t event;
+	uint32_t cpu;
+	uint64_t args[3];
+} el3_trace_record_t;
+
+#if ENABLE_EL3_TRACE && defined(IMAGE_BL31)
+#define EL3_TRACE(_event, _arg0, _arg1, _arg2)				\
+	el3_trace_record((_event), (u_register_t)(_arg0),		\
+			 (u_register_t)(_arg1), (u_register_t)(_arg2))
+#else
+#define EL3_TRACE(_event, _arg0, _arg1, _arg2)
+#endif
+
+void el3_trace_record(uint32_t event, u_register_t arg0, u_register_t arg1,
+		      u_register_t arg2);
+uintptr_t el3_trace_smc_handler(unsigned int smc_fid,
+				u_register_t cmd,
+				u_register_t arg2,
+				u_register_t arg3,
+				u_register_t arg4,
+				void *cookie,
+				void *handle,
+				u_register_t flags);
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* EL3_TRACE_H */
@@ -218,7 +218,10 @@ int gpt_init_l0_tables(gpccr_pps_e pps,
  *   pgs		PGS value to use for table generation.
  *   l1_mem_base	Base address of memory used for L1 tables.
  *   l1_mem_size	Total size of memory available for L1 tables.
- *   *pas_regions	Pointer to PAS regions structure array.
+ *   *pas_regions	Pointer to PAS regions structure array. The array is
+ *			sorted in place by base address, so it must be
+ *			writable, not in read-only memory, and its original
+ *			order is not preserved.
  *   pas_count		Total number of PAS regions.
  *
  * Return
@@ -243,6 +246,22 @@ int gpt_init_pas_l1_tables(gpccr_pgs_e pgs,
  */
 int gpt_runtime_init(void);
 
+/*
+ * Public API to find the information needed to allocate L1 tables on demand
+ * when RME_GPT_LAZY_L1 is enabled. The information is kept at the end of the
+ * L1 memory supplied to the first call to gpt_init_pas_l1_tables(), so this
+ * function must be called after gpt_runtime_init() with that same L1 memory.
+ * The pool of free L1 tables recorded there must lie within that L1 memory.
+ *
+ * Parameters
+ *   l1_mem_base	Base address of the L1 memory of the first call.
+ *   l1_mem_size	Size of the L1 memory of the first call.
+ *
+ * Return
+ *   Negative Linux error code in the event of a failure, 0 for success.
+ */
+int gpt_runtime_init_l1_pool(uintptr_t l1_mem_base, size_t l1_mem_size);
+
 /*
  * Public API to enable granule protection checks once the tables have all been
  * initialized.  This function is called at first initialization and then again
@@ -263,7 +282,8 @@ void gpt_disable(void);
  * transition request occurs it is routed to this function where the request is
  * validated then fulfilled if possible.
  *
- * TODO: implement support for transitioning multiple granules at once.
+ * A range of several granules can be transitioned in a single call. Either
+ * every granule in the range is transitioned or, on failure, none of them is.
  *
  * Parameters
  *   base: Base address of the region to transition, must be aligned to granule
@@ -277,4 +297,68 @@ void gpt_disable(void);
 int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state);
 int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state);
 
+/*
+ * Public API to get the number of times a granule transition had to wait for
+ * a GPT lock held by another CPU since boot. The L1 tables are protected by
+ * several locks so that transitions of unrelated PA ranges can run in
+ * parallel, and this counter shows how often they still serialise.
+ *
+ * Return
+ *   Total contention count over all GPT locks. A lock taken by another CPU
+ *   just as it is being acquired may not be counted, so this is a lower bound.
+ */
+uint64_t gpt_get_lock_contention(void);
+
+/*
+ * Public API to read the GPIs of a range of granules. The GPIs are packed 16
+ * per 64-bit word using the layout of L1 granules descriptors, the GPI of the
+ * n-th granule of the range being in bits [4 * (n % 16) + 3 : 4 * (n % 16)] of
+ * word n / 16.
+ *
+ * Parameters
+ *   base: Base address of the range, must be aligned to granule size.
+ *   cnt: Number of granules in the range.
+ *   gpis: Buffer receiving the GPIs, of (cnt + 15) / 16 words.
+ *
+ * Return
+ *    Negative Linux error code in the event of a failure, 0 for success.
+ */
+int gpt_get_gpis(uint64_t base, size_t cnt, uint64_t *gpis);
+
+/*
+ * Public API to check that every granule overlapped by a range of memory is in
+ * a given PAS, for instance before EL3 accesses a buffer shared by a lower EL.
+ *
+ * Parameters
+ *   base: Base address of the range.
+ *   size: Size of the range in bytes.
+ *   gpi: Expected GPI of the granules.
+ *
+ * Return
+ *    -EPERM if a granule has a different GPI, another negative Linux error
+ *    code if the range is invalid, 0 for success.
+ */
+int gpt_check_pas(uint64_t base, size_t size, unsigned int gpi);
+
+/*
+ * Public API to check that every granule overlapped by a range of memory is in
+ * a given PAS, and to keep the range in that PAS until gpt_unlock_pas() is
+ * called, for instance while EL3 writes to a buffer shared by a lower EL. The
+ * GPT locks covering the range are held in the meantime, so the caller must
+ * not transition granules before calling gpt_unlock_pas().
+ *
+ * Parameters
+ *   base: Base address of the range.
+ *   size: Size of the range in bytes.
+ *   gpi: Expected GPI of the granules.
+ *   lock_mask: Set to the mask of the locks to pass to gpt_unlock_pas().
+ *
+ * Return
+ *    -EPERM if a granule has a different GPI, another negative Linux error
+ *    code if the range is invalid, 0 for success.
+ */
+int gpt_lock_pas(uint64_t base, size_t size, unsigned int gpi,
+		 uint64_t *lock_mask);
+void gpt_unlock_pas(uint64_t lock_mask);
+
 #endif /* GPT_RME_H */
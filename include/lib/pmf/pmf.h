@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016-2020, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -40,7 +40,12 @@
  */
 #define PMF_SMC_GET_TIMESTAMP_32	U(0x82000010)
 #define PMF_SMC_GET_TIMESTAMP_64	U(0xC2000010)
+#if ENABLE_SMC_LATENCY_HIST
+#define PMF_SMC_GET_SMC_HIST_64		U(0xC2000011)
+#define PMF_NUM_SMC_CALLS		3
+#else
 #define PMF_NUM_SMC_CALLS		2
+#endif
 
 /*
  * The macros below are used to identify
@@ -54,6 +59,23 @@
 #define PMF_PSCI_STAT_SVC_ID	0
 #define PMF_RT_INSTR_SVC_ID	1
 
+/*
+ * SMC latency histograms. Bucket 'n' of a histogram counts the SMCs handled
+ * in [2^n, 2^(n+1)) system counter ticks, the last bucket counting the longer
+ * ones as well. PMF_SMC_HIST_FID_OTHER identifies the entry accumulating the
+ * SMCs of the function IDs that did not fit in the table of a CPU.
+ */
+#define PMF_SMC_HIST_BUCKETS	U(24)
+#define PMF_SMC_HIST_FID_OTHER	U(0xFFFFFFFF)
+
+typedef struct pmf_smc_hist_entry {
+	uint64_t count;
+	uint64_t total_ticks;
+	uint64_t max_ticks;
+	uint32_t hist[PMF_SMC_HIST_BUCKETS];
+	uint32_t reserved[2];
+} pmf_smc_hist_entry_t;
+
 /*******************************************************************************
  * Function & variable prototypes
  ******************************************************************************/
@@ -63,6 +85,13 @@ int pmf_get_timestamp_smc(unsigned int tid,
 		unsigned int flags,
 		unsigned long long *ts_value);
 int pmf_setup(void);
+#if ENABLE_SMC_LATENCY_HIST
+void pmf_smc_hist_record(uint32_t smc_fid, uint64_t start_ticks);
+int pmf_smc_hist_get(u_register_t mpidr,
+		unsigned int index,
+		uint32_t *smc_fid,
+		pmf_smc_hist_entry_t *entry);
+#endif
 uintptr_t pmf_smc_handler(unsigned int smc_fid,
 		u_register_t x1,
 		u_register_t x2,
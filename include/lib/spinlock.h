@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2018, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2013-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -9,6 +9,7 @@
 
 #ifndef __ASSEMBLER__
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct spinlock {
@@ -17,6 +18,9 @@ typedef struct spinlock {
 
 void spin_lock(spinlock_t *lock);
 void spin_unlock(spinlock_t *lock);
+#ifdef __aarch64__
+bool spin_trylock(spinlock_t *lock);
+#endif
 
 #else
 
@@ -35,11 +35,38 @@
  * RMI_FNUM_REQ_COMPLETE is the only function in the RMI range that originates
  * from the Realm world and is handled by the RMMD. The RMI functions are
  * always invoked by the Normal world, forwarded by RMMD and handled by the
- * RMM.
+ * RMM, with the exception of RMM_RMI_QUEUE_DOORBELL.
  */
 					/* 0x18F */
 #define RMM_RMI_REQ_COMPLETE		SMC64_RMI_FID(U(0x3F))
 
+/*
+ * Ask the RMM to process a queue of RMI commands with a single entry into the
+ * Realm world. This is handled by the RMMD when RMMD_RMI_QUEUE is enabled,
+ * which passes the queue to the RMM as an RMI call with the same FID and
+ * arguments. The queue is a 4KB aligned Non-secure page holding entries of
+ * RMI_QUEUE_ENTRY_SIZE bytes. The Normal world writes the FID and the
+ * arguments of a command in words 0 to 7 of an entry, and the RMM writes the
+ * results of the command in words 0 to 4 of the same entry.
+ * The arguments to this SMC are :
+ *    arg0 - Function ID.
+ *    arg1 - PA of the queue.
+ *    arg2 - Number of commands in the queue.
+ * The return arguments are :
+ *    ret0 - Status / error.
+ *    ret1 - Number of commands processed from the start of the queue.
+ */
+					/* 0x18E */
+#define RMM_RMI_QUEUE_DOORBELL		SMC64_RMI_FID(U(0x3E))
+
+/* Layout of the RMI command queue */
+#define RMI_QUEUE_SIZE			U(0x1000)
+#define RMI_QUEUE_ENTRY_SIZE		U(64)
+#define RMI_QUEUE_MAX_ENTRIES		(RMI_QUEUE_SIZE / RMI_QUEUE_ENTRY_SIZE)
+
+/* RMI status returned by the RMMD, as defined by the RMM specification */
+#define RMI_ERROR_INPUT			U(1)
+
 /* RMM_BOOT_COMPLETE arg0 error codes */
 #define E_RMM_BOOT_SUCCESS				(0)
 #define E_RMM_BOOT_UNKNOWN				(-1)
@@ -90,6 +117,7 @@
 #define E_RMM_BAD_PAS			-3
 #define E_RMM_NOMEM			-4
 #define E_RMM_INVAL			-5
+#define E_RMM_AGAIN			-6
 
 /* Acceptable SHA sizes for Challenge object */
 #define SHA256_DIGEST_SIZE	32U
@@ -128,6 +156,85 @@
 					/* 0x1B3 */
 #define RMM_ATTEST_GET_PLAT_TOKEN	SMC64_RMMD_EL3_FID(U(3))
 
+/*
+ * Delegate or undelegate a range of granules in a single call.
+ * The arguments to these SMCs are :
+ *    arg0 - Function ID.
+ *    arg1 - PA of the first granule of the range.
+ *    arg2 - Size of the range (in bytes), must be a multiple of the granule
+ *           size.
+ * The return arguments are :
+ *    ret0 - Status / error.
+ *    ret1 - Number of bytes transitioned from the start of the range. This
+ *           can be less than the requested size, in which case the call has
+ *           to be reissued for the remainder of the range.
+ */
+					/* 0x1B4 - 0x1B5 */
+#define RMM_GTSI_DELEGATE_RANGE		SMC64_RMMD_EL3_FID(U(4))
+#define RMM_GTSI_UNDELEGATE_RANGE	SMC64_RMMD_EL3_FID(U(5))
+
+/*
+ * Query the GPI of a granule.
+ * The arguments to this SMC are :
+ *    arg0 - Function ID.
+ *    arg1 - PA of the granule.
+ * The return arguments are :
+ *    ret0 - Status / error.
+ *    ret1 - GPI of the granule.
+ *
+ * Query the GPIs of a range of granules. The GPIs are written to a buffer in
+ * the RMM-EL3 shared buffer, packed 16 per 64-bit word with the layout of GPT
+ * L1 granules descriptors.
+ * The arguments to this SMC are :
+ *    arg0 - Function ID.
+ *    arg1 - GPI buffer Physical address, aligned to 8 bytes.
+ *    arg2 - GPI buffer size (in bytes).
+ *    arg3 - PA of the first granule of the range.
+ *    arg4 - Number of granules in the range.
+ * The return arguments are :
+ *    ret0 - Status / error.
+ *    ret1 - Number of granules whose GPI has been written to the buffer. This
+ *           can be less than requested if the buffer is too small.
+ */
+					/* 0x1B6 - 0x1B7 */
+#define RMM_GTSI_QUERY			SMC64_RMMD_EL3_FID(U(6))
+#define RMM_GTSI_QUERY_RANGE		SMC64_RMMD_EL3_FID(U(7))
+
+/* Number of GPIs packed in each 64-bit word by RMM_GTSI_QUERY_RANGE */
+#define RMM_GTSI_QUERY_GPIS_PER_WORD	U(16)
+
+/*
+ * Retrieve Platform token from EL3 without waiting for the platform to be
+ * available. The arguments and return values are the same as for
+ * RMM_ATTEST_GET_PLAT_TOKEN, with the following additional status :
+ *    E_RMM_AGAIN - The platform is busy with a request from another CPU. The
+ *                  call has to be reissued later.
+ */
+					/* 0x1B8 */
+#define RMM_ATTEST_GET_PLAT_TOKEN_ASYNC	SMC64_RMMD_EL3_FID(U(8))
+
+/*
+ * Advertise the optional behaviours supported by the RMM, which EL3 may then
+ * rely on. This can only be called during cold boot, before RMM_BOOT_COMPLETE,
+ * and EL3 assumes that none is supported if it is not called.
+ * The arguments to this SMC are :
+ *    arg0 - Function ID.
+ *    arg1 - Bitmap of RMM_CAP_* capabilities.
+ * The return arguments are :
+ *    ret0 - Status / error.
+ */
+					/* 0x1B9 */
+#define RMM_BOOT_SET_CAPS		SMC64_RMMD_EL3_FID(U(9))
+
+/*
+ * The RMM saves and restores the Non-secure EL1 and EL0 system registers
+ * around Realm execution, so EL3 does not need to switch them.
+ */
+#define RMM_CAP_PRESERVES_NS_EL1	(U(1) << 0)
+
+/* The RMM processes RMI command queues passed by RMM_RMI_QUEUE_DOORBELL */
+#define RMM_CAP_RMI_QUEUE		(U(1) << 1)
+
 /* ECC Curve types for attest key generation */
 #define ATTEST_KEY_CURVE_ECC_SECP384R1		0
 
@@ -152,7 +259,7 @@
  * Increase this when a bug is fixed, or a feature is added without
  * breaking compatibility.
  */
-#define RMM_EL3_IFC_VERSION_MINOR	(U(1))
+#define RMM_EL3_IFC_VERSION_MINOR	(U(5))
 
 #define RMM_EL3_INTERFACE_VERSION				\
 	(((RMM_EL3_IFC_VERSION_MAJOR << 16) & 0x7FFFF) |	\
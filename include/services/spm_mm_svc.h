@@ -86,6 +86,7 @@
 #define SPM_MM_NOT_SUPPORTED	 -1
 #define SPM_MM_INVALID_PARAMETER -2
 #define SPM_MM_DENIED		 -3
+#define SPM_MM_BUSY		 -4
 #define SPM_MM_NO_MEMORY	 -5
 
 #ifndef __ASSEMBLER__
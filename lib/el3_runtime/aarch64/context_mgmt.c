@@ -15,12 +15,14 @@
 #include <arch_helpers.h>
 #include <arch_features.h>
 #include <bl31/interrupt_mgmt.h>
+#include <bl31/sync_handle.h>
 #include <common/bl_common.h>
 #include <common/debug.h>
 #include <context.h>
 #include <drivers/arm/gicv3.h>
 #include <lib/el3_runtime/context_mgmt.h>
 #include <lib/el3_runtime/pubsub_events.h>
+#include <lib/el3_trace.h>
 #include <lib/extensions/amu.h>
 #include <lib/extensions/brbe.h>
 #include <lib/extensions/mpam.h>
@@ -31,6 +33,7 @@
 #include <lib/extensions/trbe.h>
 #include <lib/extensions/trf.h>
 #include <lib/utils.h>
+#include <plat/common/platform.h>
 
 #if ENABLE_FEAT_TWED
 /* Make sure delay value fits within the range(0-15) */
@@ -38,6 +41,9 @@ CASSERT(((TWED_DELAY & ~SCR_TWEDEL_MASK) == 0U), assert_twed_delay_value_check);
 #endif /* ENABLE_FEAT_TWED */
 
 static void manage_extensions_secure(cpu_context_t *ctx);
+#if CTX_INCLUDE_EL2_REGS
+static void el2_plan_init(void);
+#endif
 
 static void setup_el1_context(cpu_context_t *ctx, const struct entry_point_info *ep)
 {
@@ -360,6 +366,19 @@ static void setup_context_common(cpu_context_t *ctx, const entry_point_info_t *e
 	 */
 	write_ctx_reg(get_el3state_ctx(ctx), CTX_CPTR_EL3, read_cptr_el3());
 
+#if CTX_LAZY_FPREGS
+	/*
+	 * The Non-secure FP registers are always switched lazily, so that they
+	 * are saved when another context switching them lazily uses FP/SIMD.
+	 * Other contexts opt in through their entrypoint attributes, as their
+	 * dispatcher must not save and restore the FP registers itself.
+	 */
+	if ((GET_SECURITY_STATE(ep->h.attr) == NON_SECURE) ||
+	    (EP_GET_FPREGS_LAZY(ep->h.attr) != 0U)) {
+		write_ctx_reg(get_el3state_ctx(ctx), CTX_FPREGS_LAZY, 1U);
+	}
+#endif
+
 	/*
 	 * SCR_EL3.HCE: Enable HVC instructions if next execution state is
 	 * AArch64 and next EL is EL2, or if next execution state is AArch32 and
@@ -429,9 +448,14 @@ static void setup_context_common(cpu_context_t *ctx, const entry_point_info_t *e
 void __init cm_init(void)
 {
 	/*
-	 * The context management library has only global data to intialize, but
-	 * that will be done when the BSS is zeroed out.
+	 * The context management library has only global data to intialize,
+	 * most of which is zeroed out with the BSS. The EL2 save/restore plan
+	 * is set up from the features of the primary CPU, which all the CPUs
+	 * are expected to share.
 	 */
+#if CTX_INCLUDE_EL2_REGS
+	el2_plan_init();
+#endif
 }
 
 /*******************************************************************************
@@ -812,133 +836,243 @@ void cm_prepare_el3_exit(uint32_t security_state)
 
 #if CTX_INCLUDE_EL2_REGS
 
-static void el2_sysregs_context_save_fgt(el2_sysregs_t *ctx)
+/*******************************************************************************
+ * Save/restore plan of the EL2 sysregs that are only present with some
+ * architecture features. The features are probed once by cm_init(), so that
+ * world switches do not read the ID registers again.
+ ******************************************************************************/
+#define EL2_PLAN_MPAM		BIT_32(0)
+#define EL2_PLAN_MPAM_HCR	BIT_32(1)
+#define EL2_PLAN_FGT		BIT_32(2)
+#define EL2_PLAN_FGT_AMU	BIT_32(3)
+#define EL2_PLAN_ECV_V2		BIT_32(4)
+#define EL2_PLAN_VHE		BIT_32(5)
+#define EL2_PLAN_NV2		BIT_32(6)
+#define EL2_PLAN_TRF		BIT_32(7)
+#define EL2_PLAN_CSV2_2		BIT_32(8)
+#define EL2_PLAN_HCX		BIT_32(9)
+#define EL2_PLAN_TCR2		BIT_32(10)
+
+static uint32_t el2_plan;
+
+/* Number of MPAMVPM<n>_EL2 registers beyond MPAMVPM0_EL2 */
+static unsigned int el2_plan_mpam_vpm_max;
+
+static void __init el2_plan_init(void)
 {
-	write_ctx_reg(ctx, CTX_HDFGRTR_EL2, read_hdfgrtr_el2());
-	if (is_feat_amu_supported()) {
-		write_ctx_reg(ctx, CTX_HAFGRTR_EL2, read_hafgrtr_el2());
+	u_register_t mpam_idr;
+
+	if (is_feat_mpam_supported()) {
+		el2_plan |= EL2_PLAN_MPAM;
+
+		/*
+		 * MPAMHCR_EL2 and the MPAMVPM registers are only part of the
+		 * PE's system register frame if MPAMIDR_EL1.HAS_HCR == 1. The
+		 * number of MPAMVPM registers is implementation defined.
+		 */
+		mpam_idr = read_mpamidr_el1();
+		if ((mpam_idr & MPAMIDR_HAS_HCR_BIT) != 0U) {
+			el2_plan |= EL2_PLAN_MPAM_HCR;
+			el2_plan_mpam_vpm_max = (mpam_idr >>
+				MPAMIDR_EL1_VPMR_MAX_SHIFT) &
+				MPAMIDR_EL1_VPMR_MAX_MASK;
+		}
+	}
+
+	if (is_feat_fgt_supported()) {
+		el2_plan |= EL2_PLAN_FGT;
+		if (is_feat_amu_supported()) {
+			el2_plan |= EL2_PLAN_FGT_AMU;
+		}
+	}
+
+	if (is_feat_ecv_v2_supported()) {
+		el2_plan |= EL2_PLAN_ECV_V2;
+	}
+
+	if (is_feat_vhe_supported()) {
+		el2_plan |= EL2_PLAN_VHE;
+	}
+
+	if (is_feat_nv2_supported()) {
+		el2_plan |= EL2_PLAN_NV2;
+	}
+
+	if (is_feat_trf_supported()) {
+		el2_plan |= EL2_PLAN_TRF;
+	}
+
+	if (is_feat_csv2_2_supported()) {
+		el2_plan |= EL2_PLAN_CSV2_2;
+	}
+
+	if (is_feat_hcx_supported()) {
+		el2_plan |= EL2_PLAN_HCX;
+	}
+
+	if (is_feat_tcr2_supported()) {
+		el2_plan |= EL2_PLAN_TCR2;
 	}
-	write_ctx_reg(ctx, CTX_HDFGWTR_EL2, read_hdfgwtr_el2());
-	write_ctx_reg(ctx, CTX_HFGITR_EL2, read_hfgitr_el2());
-	write_ctx_reg(ctx, CTX_HFGRTR_EL2, read_hfgrtr_el2());
-	write_ctx_reg(ctx, CTX_HFGWTR_EL2, read_hfgwtr_el2());
 }
 
-static void el2_sysregs_context_restore_fgt(el2_sysregs_t *ctx)
+static inline bool el2_plan_has(uint32_t feat)
 {
-	write_hdfgrtr_el2(read_ctx_reg(ctx, CTX_HDFGRTR_EL2));
-	if (is_feat_amu_supported()) {
-		write_hafgrtr_el2(read_ctx_reg(ctx, CTX_HAFGRTR_EL2));
-	}
-	write_hdfgwtr_el2(read_ctx_reg(ctx, CTX_HDFGWTR_EL2));
-	write_hfgitr_el2(read_ctx_reg(ctx, CTX_HFGITR_EL2));
-	write_hfgrtr_el2(read_ctx_reg(ctx, CTX_HFGRTR_EL2));
-	write_hfgwtr_el2(read_ctx_reg(ctx, CTX_HFGWTR_EL2));
+	return (el2_plan & feat) != 0U;
 }
 
-static void el2_sysregs_context_save_mpam(el2_sysregs_t *ctx)
+/*
+ * Save the live value of an EL2 register to the context 'src', if not NULL, and
+ * write the value from the context 'dst', if not NULL, unless the register
+ * already holds it.
+ */
+#define el2_ext_sysreg_switch(_src, _dst, _reg, _offset)				\
+	do {									\
+		u_register_t _live = read_##_reg();				\
+										\
+		if ((_src) != NULL) {						\
+			write_ctx_reg((_src), (_offset), _live);		\
+		}								\
+		if (((_dst) != NULL) &&						\
+		    (read_ctx_reg((_dst), (_offset)) != _live)) {		\
+			write_##_reg(read_ctx_reg((_dst), (_offset)));		\
+		}								\
+	} while (false)
+
+static void el2_sysregs_context_switch_fgt(el2_sysregs_t *src,
+					   el2_sysregs_t *dst)
 {
-	u_register_t mpam_idr = read_mpamidr_el1();
+	el2_ext_sysreg_switch(src, dst, hdfgrtr_el2, CTX_HDFGRTR_EL2);
+	if (el2_plan_has(EL2_PLAN_FGT_AMU)) {
+		el2_ext_sysreg_switch(src, dst, hafgrtr_el2, CTX_HAFGRTR_EL2);
+	}
+	el2_ext_sysreg_switch(src, dst, hdfgwtr_el2, CTX_HDFGWTR_EL2);
+	el2_ext_sysreg_switch(src, dst, hfgitr_el2, CTX_HFGITR_EL2);
+	el2_ext_sysreg_switch(src, dst, hfgrtr_el2, CTX_HFGRTR_EL2);
+	el2_ext_sysreg_switch(src, dst, hfgwtr_el2, CTX_HFGWTR_EL2);
+}
 
-	write_ctx_reg(ctx, CTX_MPAM2_EL2, read_mpam2_el2());
+static void el2_sysregs_context_switch_mpam(el2_sysregs_t *src,
+					    el2_sysregs_t *dst)
+{
+	el2_ext_sysreg_switch(src, dst, mpam2_el2, CTX_MPAM2_EL2);
 
-	/*
-	 * The context registers that we intend to save would be part of the
-	 * PE's system register frame only if MPAMIDR_EL1.HAS_HCR == 1.
-	 */
-	if ((mpam_idr & MPAMIDR_HAS_HCR_BIT) == 0U) {
+	if (!el2_plan_has(EL2_PLAN_MPAM_HCR)) {
 		return;
 	}
 
-	/*
-	 * MPAMHCR_EL2, MPAMVPMV_EL2 and MPAMVPM0_EL2 are always present if
-	 * MPAMIDR_HAS_HCR_BIT == 1.
-	 */
-	write_ctx_reg(ctx, CTX_MPAMHCR_EL2, read_mpamhcr_el2());
-	write_ctx_reg(ctx, CTX_MPAMVPM0_EL2, read_mpamvpm0_el2());
-	write_ctx_reg(ctx, CTX_MPAMVPMV_EL2, read_mpamvpmv_el2());
+	el2_ext_sysreg_switch(src, dst, mpamhcr_el2, CTX_MPAMHCR_EL2);
+	el2_ext_sysreg_switch(src, dst, mpamvpm0_el2, CTX_MPAMVPM0_EL2);
+	el2_ext_sysreg_switch(src, dst, mpamvpmv_el2, CTX_MPAMVPMV_EL2);
 
-	/*
-	 * The number of MPAMVPM registers is implementation defined, their
-	 * number is stored in the MPAMIDR_EL1 register.
-	 */
-	switch ((mpam_idr >> MPAMIDR_EL1_VPMR_MAX_SHIFT) & MPAMIDR_EL1_VPMR_MAX_MASK) {
+	switch (el2_plan_mpam_vpm_max) {
 	case 7:
-		write_ctx_reg(ctx, CTX_MPAMVPM7_EL2, read_mpamvpm7_el2());
+		el2_ext_sysreg_switch(src, dst, mpamvpm7_el2, CTX_MPAMVPM7_EL2);
 		__fallthrough;
 	case 6:
-		write_ctx_reg(ctx, CTX_MPAMVPM6_EL2, read_mpamvpm6_el2());
+		el2_ext_sysreg_switch(src, dst, mpamvpm6_el2, CTX_MPAMVPM6_EL2);
 		__fallthrough;
 	case 5:
-		write_ctx_reg(ctx, CTX_MPAMVPM5_EL2, read_mpamvpm5_el2());
+		el2_ext_sysreg_switch(src, dst, mpamvpm5_el2, CTX_MPAMVPM5_EL2);
 		__fallthrough;
 	case 4:
-		write_ctx_reg(ctx, CTX_MPAMVPM4_EL2, read_mpamvpm4_el2());
+		el2_ext_sysreg_switch(src, dst, mpamvpm4_el2, CTX_MPAMVPM4_EL2);
 		__fallthrough;
 	case 3:
-		write_ctx_reg(ctx, CTX_MPAMVPM3_EL2, read_mpamvpm3_el2());
+		el2_ext_sysreg_switch(src, dst, mpamvpm3_el2, CTX_MPAMVPM3_EL2);
 		__fallthrough;
 	case 2:
-		write_ctx_reg(ctx, CTX_MPAMVPM2_EL2, read_mpamvpm2_el2());
+		el2_ext_sysreg_switch(src, dst, mpamvpm2_el2, CTX_MPAMVPM2_EL2);
 		__fallthrough;
 	case 1:
-		write_ctx_reg(ctx, CTX_MPAMVPM1_EL2, read_mpamvpm1_el2());
+		el2_ext_sysreg_switch(src, dst, mpamvpm1_el2, CTX_MPAMVPM1_EL2);
+		break;
+	default:
 		break;
 	}
 }
 
-static void el2_sysregs_context_restore_mpam(el2_sysregs_t *ctx)
+/*******************************************************************************
+ * Save the EL2 sysregs that are only present with some architecture features
+ * to 'src' and restore them from 'dst', following the plan set up by cm_init().
+ * Either context may be NULL to only restore or save the registers. Registers
+ * that already hold the value to restore are not written.
+ ******************************************************************************/
+static void el2_sysregs_context_switch_ext(el2_sysregs_t *src,
+					   el2_sysregs_t *dst)
 {
-	u_register_t mpam_idr = read_mpamidr_el1();
+#if CTX_INCLUDE_MTE_REGS
+	if (src != NULL) {
+		el2_sysregs_context_save_mte(src);
+	}
+	if (dst != NULL) {
+		el2_sysregs_context_restore_mte(dst);
+	}
+#endif
+	if (el2_plan_has(EL2_PLAN_MPAM)) {
+		el2_sysregs_context_switch_mpam(src, dst);
+	}
 
-	write_mpam2_el2(read_ctx_reg(ctx, CTX_MPAM2_EL2));
+	if (el2_plan_has(EL2_PLAN_FGT)) {
+		el2_sysregs_context_switch_fgt(src, dst);
+	}
 
-	if ((mpam_idr & MPAMIDR_HAS_HCR_BIT) == 0U) {
-		return;
+	if (el2_plan_has(EL2_PLAN_ECV_V2)) {
+		el2_ext_sysreg_switch(src, dst, cntpoff_el2, CTX_CNTPOFF_EL2);
 	}
 
-	write_mpamhcr_el2(read_ctx_reg(ctx, CTX_MPAMHCR_EL2));
-	write_mpamvpm0_el2(read_ctx_reg(ctx, CTX_MPAMVPM0_EL2));
-	write_mpamvpmv_el2(read_ctx_reg(ctx, CTX_MPAMVPMV_EL2));
+	if (el2_plan_has(EL2_PLAN_VHE)) {
+		el2_ext_sysreg_switch(src, dst, contextidr_el2, CTX_CONTEXTIDR_EL2);
+		el2_ext_sysreg_switch(src, dst, ttbr1_el2, CTX_TTBR1_EL2);
+	}
+#if RAS_EXTENSION
+	if (src != NULL) {
+		el2_sysregs_context_save_ras(src);
+	}
+	if (dst != NULL) {
+		el2_sysregs_context_restore_ras(dst);
+	}
+#endif
 
-	switch ((mpam_idr >> MPAMIDR_EL1_VPMR_MAX_SHIFT) & MPAMIDR_EL1_VPMR_MAX_MASK) {
-	case 7:
-		write_mpamvpm7_el2(read_ctx_reg(ctx, CTX_MPAMVPM7_EL2));
-		__fallthrough;
-	case 6:
-		write_mpamvpm6_el2(read_ctx_reg(ctx, CTX_MPAMVPM6_EL2));
-		__fallthrough;
-	case 5:
-		write_mpamvpm5_el2(read_ctx_reg(ctx, CTX_MPAMVPM5_EL2));
-		__fallthrough;
-	case 4:
-		write_mpamvpm4_el2(read_ctx_reg(ctx, CTX_MPAMVPM4_EL2));
-		__fallthrough;
-	case 3:
-		write_mpamvpm3_el2(read_ctx_reg(ctx, CTX_MPAMVPM3_EL2));
-		__fallthrough;
-	case 2:
-		write_mpamvpm2_el2(read_ctx_reg(ctx, CTX_MPAMVPM2_EL2));
-		__fallthrough;
-	case 1:
-		write_mpamvpm1_el2(read_ctx_reg(ctx, CTX_MPAMVPM1_EL2));
-		break;
+	if (el2_plan_has(EL2_PLAN_NV2)) {
+		el2_ext_sysreg_switch(src, dst, vncr_el2, CTX_VNCR_EL2);
+	}
+
+	if (el2_plan_has(EL2_PLAN_TRF)) {
+		el2_ext_sysreg_switch(src, dst, trfcr_el2, CTX_TRFCR_EL2);
+	}
+
+	if (el2_plan_has(EL2_PLAN_CSV2_2)) {
+		el2_ext_sysreg_switch(src, dst, scxtnum_el2, CTX_SCXTNUM_EL2);
+	}
+
+	if (el2_plan_has(EL2_PLAN_HCX)) {
+		el2_ext_sysreg_switch(src, dst, hcrx_el2, CTX_HCRX_EL2);
+	}
+	if (el2_plan_has(EL2_PLAN_TCR2)) {
+		el2_ext_sysreg_switch(src, dst, tcr2_el2, CTX_TCR2_EL2);
 	}
 }
 
+/*
+ * Return true if the EL2 context of 'security_state' is in use, which is the
+ * case for the Secure world only if S-EL2 is enabled.
+ */
+static bool el2_sysregs_context_in_use(uint32_t security_state)
+{
+	return (security_state != SECURE) ||
+	       ((read_scr() & SCR_EEL2_BIT) != 0U);
+}
+
 /*******************************************************************************
  * Save EL2 sysreg context
  ******************************************************************************/
 void cm_el2_sysregs_context_save(uint32_t security_state)
 {
-	u_register_t scr_el3 = read_scr();
-
 	/*
 	 * Always save the non-secure and realm EL2 context, only save the
 	 * S-EL2 context if S-EL2 is enabled.
 	 */
-	if ((security_state != SECURE) ||
-	    ((security_state == SECURE) && ((scr_el3 & SCR_EEL2_BIT) != 0U))) {
+	if (el2_sysregs_context_in_use(security_state)) {
 		cpu_context_t *ctx;
 		el2_sysregs_t *el2_sysregs_ctx;
 
@@ -948,52 +1082,7 @@ void cm_el2_sysregs_context_save(uint32_t security_state)
 		el2_sysregs_ctx = get_el2_sysregs_ctx(ctx);
 
 		el2_sysregs_context_save_common(el2_sysregs_ctx);
-#if CTX_INCLUDE_MTE_REGS
-		el2_sysregs_context_save_mte(el2_sysregs_ctx);
-#endif
-		if (is_feat_mpam_supported()) {
-			el2_sysregs_context_save_mpam(el2_sysregs_ctx);
-		}
-
-		if (is_feat_fgt_supported()) {
-			el2_sysregs_context_save_fgt(el2_sysregs_ctx);
-		}
-
-		if (is_feat_ecv_v2_supported()) {
-			write_ctx_reg(el2_sysregs_ctx, CTX_CNTPOFF_EL2,
-				      read_cntpoff_el2());
-		}
-
-		if (is_feat_vhe_supported()) {
-			write_ctx_reg(el2_sysregs_ctx, CTX_CONTEXTIDR_EL2,
-				      read_contextidr_el2());
-			write_ctx_reg(el2_sysregs_ctx, CTX_TTBR1_EL2,
-				      read_ttbr1_el2());
-		}
-#if RAS_EXTENSION
-		el2_sysregs_context_save_ras(el2_sysregs_ctx);
-#endif
-
-		if (is_feat_nv2_supported()) {
-			write_ctx_reg(el2_sysregs_ctx, CTX_VNCR_EL2,
-				      read_vncr_el2());
-		}
-
-		if (is_feat_trf_supported()) {
-			write_ctx_reg(el2_sysregs_ctx, CTX_TRFCR_EL2, read_trfcr_el2());
-		}
-
-		if (is_feat_csv2_2_supported()) {
-			write_ctx_reg(el2_sysregs_ctx, CTX_SCXTNUM_EL2,
-				      read_scxtnum_el2());
-		}
-
-		if (is_feat_hcx_supported()) {
-			write_ctx_reg(el2_sysregs_ctx, CTX_HCRX_EL2, read_hcrx_el2());
-		}
-		if (is_feat_tcr2_supported()) {
-			write_ctx_reg(el2_sysregs_ctx, CTX_TCR2_EL2, read_tcr2_el2());
-		}
+		el2_sysregs_context_switch_ext(el2_sysregs_ctx, NULL);
 	}
 }
 
@@ -1002,14 +1091,11 @@ void cm_el2_sysregs_context_save(uint32_t security_state)
  ******************************************************************************/
 void cm_el2_sysregs_context_restore(uint32_t security_state)
 {
-	u_register_t scr_el3 = read_scr();
-
 	/*
 	 * Always restore the non-secure and realm EL2 context, only restore the
 	 * S-EL2 context if S-EL2 is enabled.
 	 */
-	if ((security_state != SECURE) ||
-	    ((security_state == SECURE) && ((scr_el3 & SCR_EEL2_BIT) != 0U))) {
+	if (el2_sysregs_context_in_use(security_state)) {
 		cpu_context_t *ctx;
 		el2_sysregs_t *el2_sysregs_ctx;
 
@@ -1019,49 +1105,37 @@ void cm_el2_sysregs_context_restore(uint32_t security_state)
 		el2_sysregs_ctx = get_el2_sysregs_ctx(ctx);
 
 		el2_sysregs_context_restore_common(el2_sysregs_ctx);
-#if CTX_INCLUDE_MTE_REGS
-		el2_sysregs_context_restore_mte(el2_sysregs_ctx);
-#endif
-		if (is_feat_mpam_supported()) {
-			el2_sysregs_context_restore_mpam(el2_sysregs_ctx);
-		}
-
-		if (is_feat_fgt_supported()) {
-			el2_sysregs_context_restore_fgt(el2_sysregs_ctx);
-		}
-
-		if (is_feat_ecv_v2_supported()) {
-			write_cntpoff_el2(read_ctx_reg(el2_sysregs_ctx,
-						       CTX_CNTPOFF_EL2));
-		}
+		el2_sysregs_context_switch_ext(NULL, el2_sysregs_ctx);
+	}
+}
 
-		if (is_feat_vhe_supported()) {
-			write_contextidr_el2(read_ctx_reg(el2_sysregs_ctx, CTX_CONTEXTIDR_EL2));
-			write_ttbr1_el2(read_ctx_reg(el2_sysregs_ctx, CTX_TTBR1_EL2));
-		}
-#if RAS_EXTENSION
-		el2_sysregs_context_restore_ras(el2_sysregs_ctx);
-#endif
+/*******************************************************************************
+ * Switch the EL2 sysreg context from one security state to another. This is
+ * equivalent to saving the context of 'src_state' and restoring the one of
+ * 'dst_state', except that the registers are only written when the two states
+ * hold different values for them.
+ ******************************************************************************/
+void cm_el2_sysregs_context_switch(uint32_t src_state, uint32_t dst_state)
+{
+	el2_sysregs_t *src_ctx;
+	el2_sysregs_t *dst_ctx;
+
+	/* Only switch in a single pass when both states have an EL2 context. */
+	if (!el2_sysregs_context_in_use(src_state) ||
+	    !el2_sysregs_context_in_use(dst_state)) {
+		cm_el2_sysregs_context_save(src_state);
+		cm_el2_sysregs_context_restore(dst_state);
+		return;
+	}
 
-		if (is_feat_nv2_supported()) {
-			write_vncr_el2(read_ctx_reg(el2_sysregs_ctx, CTX_VNCR_EL2));
-		}
-		if (is_feat_trf_supported()) {
-			write_trfcr_el2(read_ctx_reg(el2_sysregs_ctx, CTX_TRFCR_EL2));
-		}
+	assert(cm_get_context(src_state) != NULL);
+	assert(cm_get_context(dst_state) != NULL);
 
-		if (is_feat_csv2_2_supported()) {
-			write_scxtnum_el2(read_ctx_reg(el2_sysregs_ctx,
-						       CTX_SCXTNUM_EL2));
-		}
+	src_ctx = get_el2_sysregs_ctx(cm_get_context(src_state));
+	dst_ctx = get_el2_sysregs_ctx(cm_get_context(dst_state));
 
-		if (is_feat_hcx_supported()) {
-			write_hcrx_el2(read_ctx_reg(el2_sysregs_ctx, CTX_HCRX_EL2));
-		}
-		if (is_feat_tcr2_supported()) {
-			write_tcr2_el2(read_ctx_reg(el2_sysregs_ctx, CTX_TCR2_EL2));
-		}
-	}
+	el2_sysregs_context_switch_common(src_ctx, dst_ctx);
+	el2_sysregs_context_switch_ext(src_ctx, dst_ctx);
 }
 #endif /* CTX_INCLUDE_EL2_REGS */
 
@@ -1250,5 +1324,141 @@ void cm_set_next_eret_context(uint32_t security_state)
 	ctx = cm_get_context(security_state);
 	assert(ctx != NULL);
 
+	EL3_TRACE(EL3_TRACE_WORLD_SWITCH, security_state, ctx, 0U);
+
 	cm_set_next_context(ctx);
 }
+
+#if CTX_LAZY_FPREGS
+/*******************************************************************************
+ * With CTX_LAZY_FPREGS, the FP registers of a CPU hold the FP context of at
+ * most one of the cpu_contexts run on it that switch them lazily, its owner.
+ * The CTX_FPREGS_OWNER slot of such a context holds the MPIDR of the CPU whose
+ * FP registers are newer than its saved FP context, or 0 if there is none.
+ * el3_exit() traps the FP/SIMD accesses of any such context that is not live in
+ * the FP registers of the CPU it runs on, and the FP registers are only
+ * switched when such an access is trapped.
+ *
+ * Contexts whose CTX_FPREGS_LAZY slot is 0 are never trapped. Their dispatcher
+ * or lower EL software must preserve the FP registers, as without the option.
+ ******************************************************************************/
+static cpu_context_t *fpregs_owner[PLATFORM_CORE_COUNT];
+
+/* Return true if the FP registers of this CPU hold the FP context of 'ctx' */
+static bool fpregs_is_live(cpu_context_t *ctx)
+{
+	return read_ctx_reg(get_el3state_ctx(ctx), CTX_FPREGS_OWNER) ==
+		read_mpidr_el1();
+}
+
+static void fpregs_set_owner(cpu_context_t *ctx, u_register_t mpidr)
+{
+	write_ctx_reg(get_el3state_ctx(ctx), CTX_FPREGS_OWNER, mpidr);
+}
+
+/*
+ * Allow EL3 to access the FP registers, which el3_exit() may have trapped for
+ * the context that was last run.
+ */
+static void fpregs_enable_el3_access(void)
+{
+	write_cptr_el3(read_cptr_el3() & ~TFP_BIT);
+	isb();
+}
+
+/*******************************************************************************
+ * Handle an FP/SIMD access trapped from the lower EL context 'ctx'. Save the FP
+ * registers to the context owning them, load them from 'ctx' and make it the
+ * owner, so that the trapping instruction can be repeated.
+ ******************************************************************************/
+int cm_handle_fpregs_trap(cpu_context_t *ctx)
+{
+	unsigned int cpu = plat_my_core_pos();
+	cpu_context_t *owner = fpregs_owner[cpu];
+	u_register_t ctx_owner;
+
+	/*
+	 * FP/SIMD accesses are really disabled for this context, or it does not
+	 * switch its FP registers lazily and should not have been trapped.
+	 */
+	if (((read_ctx_reg(get_el3state_ctx(ctx), CTX_CPTR_EL3) & TFP_BIT) != 0U) ||
+	    (read_ctx_reg(get_el3state_ctx(ctx), CTX_FPREGS_LAZY) == 0U)) {
+		return TRAP_RET_UNHANDLED;
+	}
+
+	fpregs_enable_el3_access();
+
+	/*
+	 * The registers are only saved if they still hold the owner's FP
+	 * context. The owner may since have been reinitialised, or its FP
+	 * context claimed by another CPU.
+	 */
+	if ((owner != NULL) && (owner != ctx) && fpregs_is_live(owner)) {
+		fpregs_context_save(get_fpregs_ctx(owner));
+		fpregs_set_owner(owner, 0U);
+	}
+
+	/*
+	 * 'ctx' was live on another CPU, i.e. it has migrated without its FP
+	 * registers being saved or released first. Its FP context since then is
+	 * lost. Claiming it below stops the other CPU from saving over it.
+	 */
+	ctx_owner = read_ctx_reg(get_el3state_ctx(ctx), CTX_FPREGS_OWNER);
+	if ((ctx_owner != 0U) && (ctx_owner != read_mpidr_el1())) {
+		WARN("FP context live on CPU 0x%lx trapped on CPU 0x%lx\n",
+		     ctx_owner, read_mpidr_el1());
+	}
+
+	fpregs_context_restore(get_fpregs_ctx(ctx));
+	fpregs_set_owner(ctx, read_mpidr_el1());
+	fpregs_owner[cpu] = ctx;
+
+	return TRAP_RET_REPEAT;
+}
+
+/*******************************************************************************
+ * Save the FP registers of this CPU to the context owning them, if any, e.g.
+ * before they are lost when the CPU is powered down.
+ ******************************************************************************/
+void cm_fpregs_lazy_flush(void)
+{
+	unsigned int cpu = plat_my_core_pos();
+	cpu_context_t *owner = fpregs_owner[cpu];
+
+	fpregs_owner[cpu] = NULL;
+
+	if ((owner == NULL) || !fpregs_is_live(owner)) {
+		return;
+	}
+
+	fpregs_enable_el3_access();
+	fpregs_context_save(get_fpregs_ctx(owner));
+	fpregs_set_owner(owner, 0U);
+}
+
+/*******************************************************************************
+ * Drop the FP context of 'ctx' if it owns the FP registers of this CPU, without
+ * saving it, e.g. when the context has run to completion and may next run on
+ * another CPU.
+ ******************************************************************************/
+void cm_fpregs_lazy_release(cpu_context_t *ctx)
+{
+	unsigned int cpu = plat_my_core_pos();
+
+	if (fpregs_owner[cpu] == ctx) {
+		fpregs_owner[cpu] = NULL;
+	}
+
+	if (fpregs_is_live(ctx)) {
+		fpregs_set_owner(ctx, 0U);
+	}
+}
+
+static void *fpregs_lazy_pwrdown_hook(const void *arg)
+{
+	cm_fpregs_lazy_flush();
+	return (void *)0;
+}
+
+SUBSCRIBE_TO_EVENT(psci_suspend_pwrdown_start, fpregs_lazy_pwrdown_hook);
+#endif /* CTX_LAZY_FPREGS */
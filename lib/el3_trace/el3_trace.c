@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2023, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <arch_helpers.h>
+#include <common/debug.h>
+#include <lib/cassert.h>
+#include <lib/el3_trace.h>
+#include <lib/gpt_rme/gpt_rme.h>
+#include <lib/smccc.h>
+#include <lib/spinlock.h>
+#include <lib/utils_def.h>
+#include <lib/xlat_tables/xlat_tables_v2.h>
+#include <plat/common/platform.h>
+#include <smccc_helpers.h>
+
+#include <platform_def.h>
+
+/* Number of records in the ring of each CPU, a power of 2 */
+#ifndef PLAT_EL3_TRACE_RECORDS
+#define PLAT_EL3_TRACE_RECORDS		U(64)
+#endif
+
+/* Largest buffer that the Non-secure world may share for draining */
+#define EL3_TRACE_SHARED_BUF_MAX	(U(16) * PAGE_SIZE_4KB)
+
+CASSERT(IS_POWER_OF_TWO(PLAT_EL3_TRACE_RECORDS),
+	assert_el3_trace_records_not_power_of_two);
+
+/*
+ * Ring of a CPU. Only that CPU writes records, with interrupts masked in EL3,
+ * so writing is lock-free. Each record is guarded by its sequence number,
+ * which is cleared while the record is written, so that a CPU draining the
+ * ring can tell whether a record was overwritten while being copied. 'tail'
+ * is only accessed by the CPU draining the ring, with el3_trace_lock held.
+ */
+typedef struct el3_trace_ring {
+	el3_trace_record_t records[PLAT_EL3_TRACE_RECORDS];
+	uint64_t head;
+	uint64_t tail;
+} el3_trace_ring_t;
+
+static el3_trace_ring_t el3_trace_rings[PLATFORM_CORE_COUNT]
+	__aligned(CACHE_WRITEBACK_GRANULE);
+
+/* el3_trace_lock protects the shared buffer and the tails of the rings */
+static spinlock_t el3_trace_lock;
+static uintptr_t el3_trace_shared_buf;
+static size_t el3_trace_shared_size;
+static uint64_t el3_trace_shared_pa;
+
+/*
+ * The shared buffer is accessed with Non-secure attributes. With RME, the
+ * Normal world may pass the address of memory of another world, or delegate
+ * the buffer after sharing it, and a granule protection fault in EL3 is fatal.
+ * Check that the buffer is in the Non-secure PAS and hold the GPT locks
+ * covering it, so that it cannot be delegated while it is written, until
+ * el3_trace_shared_buf_unlock() is called.
+ */
+static bool el3_trace_shared_buf_lock(uint64_t pa, size_t size,
+				      uint64_t *gpt_lock_mask)
+{
+#if ENABLE_RME
+	return gpt_lock_pas(pa, size, GPT_GPI_NS, gpt_lock_mask) == 0;
+#else
+	*gpt_lock_mask = 0U;
+	return true;
+#endif
+}
+
+static void el3_trace_shared_buf_unlock(uint64_t gpt_lock_mask)
+{
+#if ENABLE_RME
+	gpt_unlock_pas(gpt_lock_mask);
+#else
+	(void)gpt_lock_mask;
+#endif
+}
+
+/*
+ * Append a record to the ring of this CPU, overwriting the oldest one if the
+ * ring is full.
+ */
+void el3_trace_record(uint32_t event, u_register_t arg0, u_register_t arg1,
+		      u_register_t arg2)
+{
+	unsigned int cpu = plat_my_core_pos();
+	el3_trace_ring_t *ring = &el3_trace_rings[cpu];
+	uint64_t head = ring->head;
+	el3_trace_record_t *rec =
+		&ring->records[head & (PLAT_EL3_TRACE_RECORDS - 1U)];
+
+	*(volatile uint64_t *)&rec->seq = 0U;
+	dmbishst();
+
+	rec->timestamp = read_cntpct_el0();
+	rec->event = event;
+	rec->cpu = cpu;
+	rec->args[0] = arg0;
+	rec->args[1] = arg1;
+	rec->args[2] = arg2;
+	dmbishst();
+
+	*(volatile uint64_t *)&rec->seq = head + 1U;
+	dmbishst();
+
+	*(volatile uint64_t *)&ring->head = head + 1U;
+}
+
+/*
+ * Copy the records of the ring of CPU 'core_pos' that have not been drained
+ * yet to the shared buffer, oldest first. Return the number of records copied,
+ * and the number of records overwritten before they could be drained in
+ * 'lost'.
+ */
+static unsigned int el3_trace_drain(unsigned int core_pos, uint64_t *lost)
+{
+	el3_trace_ring_t *ring = &el3_trace_rings[core_pos];
+	el3_trace_record_t *out = (el3_trace_record_t *)el3_trace_shared_buf;
+	unsigned int max = el3_trace_shared_size / sizeof(el3_trace_record_t);
+	unsigned int nr = 0U;
+	uint64_t head, tail, seq;
+	el3_trace_record_t rec;
+	const el3_trace_record_t *src;
+
+	head = *(volatile uint64_t *)&ring->head;
+	dmbishld();
+
+	tail = ring->tail;
+	*lost = 0U;
+	if ((head - tail) > PLAT_EL3_TRACE_RECORDS) {
+		*lost = head - tail - PLAT_EL3_TRACE_RECORDS;
+		tail = head - PLAT_EL3_TRACE_RECORDS;
+	}
+
+	for (; (tail != head) && (nr < max); tail++) {
+		src = &ring->records[tail & (PLAT_EL3_TRACE_RECORDS - 1U)];
+
+		seq = *(volatile const uint64_t *)&src->seq;
+		dmbishld();
+		(void)memcpy(&rec, src, sizeof(rec));
+		dmbishld();
+
+		/* Skip the record if the CPU is overwriting it */
+		if ((seq != (tail + 1U)) ||
+		    (*(volatile const uint64_t *)&src->seq != seq)) {
+			(*lost)++;
+			continue;
+		}
+
+		rec.seq = seq;
+		(void)memcpy(&out[nr], &rec, sizeof(rec));
+		nr++;
+	}
+
+	ring->tail = tail;
+
+	return nr;
+}
+
+uintptr_t el3_trace_smc_handler(unsigned int smc_fid,
+				u_register_t cmd,
+				u_register_t arg2,
+				u_register_t arg3,
+				u_register_t arg4,
+				void *cookie,
+				void *handle,
+				u_register_t flags)
+{
+	int64_t smc_ret = EL3_TRACE_E_INVALID_PARAMS;
+	uint64_t smc_resp = 0U, lost = 0U;
+	uint64_t gpt_lock_mask;
+	int core_pos;
+	int ret;
+
+	/* Allow calls from non-secure only */
+	if (!is_caller_non_secure(flags)) {
+		SMC_RET1(handle, EL3_TRACE_E_DENIED);
+	}
+
+	/* Expect a SiP service SMC64 fast call */
+	if ((GET_SMC_TYPE(smc_fid) != SMC_TYPE_FAST) ||
+	    (GET_SMC_CC(smc_fid) != SMC_64) ||
+	    (GET_SMC_OEN(smc_fid) != OEN_SIP_START)) {
+		SMC_RET1(handle, SMC_UNK);
+	}
+
+	spin_lock(&el3_trace_lock);
+
+	switch (cmd) {
+	case EL3_TRACE_CMD_VERSION:
+		smc_ret = SMC_OK;
+		smc_resp = EL3_TRACE_VERSION;
+		break;
+
+	case EL3_TRACE_CMD_INIT:
+		/* x2: base address, x3: size of the shared buffer */
+		if ((el3_trace_shared_buf != 0U) ||
+		    ((arg2 & (PAGE_SIZE_4KB - 1U)) != 0U) ||
+		    ((arg3 & (PAGE_SIZE_4KB - 1U)) != 0U) ||
+		    (arg3 == 0U) || (arg3 > EL3_TRACE_SHARED_BUF_MAX) ||
+		    !el3_trace_shared_buf_lock(arg2, arg3, &gpt_lock_mask)) {
+			break;
+		}
+		el3_trace_shared_buf_unlock(gpt_lock_mask);
+
+		ret = mmap_add_dynamic_region_alloc_va(arg2,
+				&el3_trace_shared_buf, arg3,
+				MT_MEMORY | MT_RW | MT_NS | MT_EXECUTE_NEVER);
+		if (ret != 0) {
+			el3_trace_shared_buf = 0U;
+			break;
+		}
+
+		el3_trace_shared_pa = arg2;
+		el3_trace_shared_size = arg3;
+		smc_ret = SMC_OK;
+		break;
+
+	case EL3_TRACE_CMD_DRAIN:
+		/* x2: MPIDR of the CPU whose ring is drained */
+		core_pos = plat_core_pos_by_mpidr(arg2);
+		if ((el3_trace_shared_buf == 0U) || (core_pos < 0) ||
+		    !el3_trace_shared_buf_lock(el3_trace_shared_pa,
+					       el3_trace_shared_size,
+					       &gpt_lock_mask)) {
+			break;
+		}
+
+		smc_resp = el3_trace_drain((unsigned int)core_pos, &lost);
+		el3_trace_shared_buf_unlock(gpt_lock_mask);
+		smc_ret = SMC_OK;
+		break;
+
+	default:
+		smc_ret = SMC_UNK;
+		break;
+	}
+
+	spin_unlock(&el3_trace_lock);
+
+	SMC_RET3(handle, smc_ret, smc_resp, lost);
+}
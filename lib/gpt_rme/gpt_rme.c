@@ -9,15 +9,19 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <arch.h>
 #include <arch_helpers.h>
 #include <common/debug.h>
 #include "gpt_rme_private.h"
+#include <lib/cassert.h>
+#include <lib/el3_trace.h>
 #include <lib/gpt_rme/gpt_rme.h>
 #include <lib/smccc.h>
 #include <lib/spinlock.h>
 #include <lib/xlat_tables/xlat_tables_v2.h>
+#include <platform_def.h>
 
 #if !ENABLE_RME
 #error "ENABLE_RME must be enabled to use the GPT library."
@@ -73,6 +77,9 @@ static gpt_config_t gpt_config;
 static unsigned int gpt_next_l1_tbl_idx;
 static uintptr_t gpt_l1_tbl;
 
+/* Time spent building the tables, in system counter ticks. */
+static uint64_t gpt_setup_ticks;
+
 /*
  * This function checks to see if a GPI value is valid.
  *
@@ -121,39 +128,116 @@ static bool gpt_check_pas_overlap(uintptr_t base_1, size_t size_1,
 }
 
 /*
- * This helper function checks to see if a PAS region from index 0 to
- * (pas_idx - 1) occupies the L0 region at index l0_idx in the L0 table.
+ * This function sorts an array of PAS regions by base address, so that they can
+ * then be validated and generated in a single pass. Insertion sort is used as
+ * arrays are small and usually already sorted, in which case it is linear.
+ *
+ * Parameters
+ *   *pas_regions	Pointer to array of PAS region structures.
+ *   pas_region_cnt	Total number of PAS regions in the array.
+ */
+static void gpt_sort_pas_regions(pas_region_t *pas_regions,
+				 unsigned int pas_region_cnt)
+{
+	pas_region_t pas;
+	unsigned int i;
+
+	for (unsigned int idx = 1U; idx < pas_region_cnt; idx++) {
+		pas = pas_regions[idx];
+		for (i = idx; (i > 0U) &&
+		     (pas_regions[i - 1U].base_pa > pas.base_pa); i--) {
+			pas_regions[i] = pas_regions[i - 1U];
+		}
+		pas_regions[i] = pas;
+	}
+}
+
+#if RME_GPT_LAZY_L1
+/*
+ * On-demand L1 table information, stored at the end of the L1 memory supplied
+ * to the first call to gpt_init_pas_l1_tables().
+ */
+static gpt_lazy_l1_info_t *gpt_lazy_l1_info;
+
+/*
+ * Helper to get the address of the on-demand L1 table information at the end
+ * of a range of L1 memory.
  *
  * Parameters
- *   l0_idx:      Index of the L0 entry to check
- *   pas_regions: PAS region array
- *   pas_idx:     Upper bound of the PAS array index.
+ *   l1_mem_base	Base address of the L1 memory.
+ *   l1_mem_size	Size of the L1 memory.
  *
  * Return
- *   True if a PAS region occupies the L0 region in question, false if not.
+ *   Address of the information, or 0 if it does not fit in the L1 memory.
  */
-static bool gpt_does_previous_pas_exist_here(unsigned int l0_idx,
-					     pas_region_t *pas_regions,
-					     unsigned int pas_idx)
+static uintptr_t gpt_get_lazy_l1_info_addr(uintptr_t l1_mem_base,
+					   size_t l1_mem_size)
 {
-	/* Iterate over PAS regions up to pas_idx. */
-	for (unsigned int i = 0U; i < pas_idx; i++) {
-		if (gpt_check_pas_overlap((GPT_L0GPTSZ_ACTUAL_SIZE * l0_idx),
-		    GPT_L0GPTSZ_ACTUAL_SIZE,
-		    pas_regions[i].base_pa, pas_regions[i].size)) {
-			return true;
-		}
+	size_t info_size = GPT_LAZY_L1_INFO_SIZE(gpt_config.t);
+
+	if (l1_mem_size < info_size) {
+		return 0U;
 	}
-	return false;
+
+	return (l1_mem_base + l1_mem_size - info_size) &
+	       ~(sizeof(uint64_t) - 1UL);
+}
+
+/*
+ * Helper to get the number of L0 regions entirely covered by a PAS region.
+ *
+ * Parameters
+ *   base		Base address of the PAS region.
+ *   size		Size of the PAS region.
+ *
+ * Return
+ *   Number of L0 regions covered.
+ */
+static unsigned int gpt_get_full_l0_cnt(uintptr_t base, size_t size)
+{
+	uintptr_t first = (base + GPT_L0_REGION_SIZE - 1UL) &
+			  ~(GPT_L0_REGION_SIZE - 1UL);
+	uintptr_t last = (base + size) & ~(GPT_L0_REGION_SIZE - 1UL);
+
+	if (last <= first) {
+		return 0U;
+	}
+
+	return (unsigned int)((last - first) >> GPT_L0_IDX_SHIFT);
+}
+
+/*
+ * Helper to check whether an L0 region is still waiting for its L1 table, in
+ * which case all its granules have the GPI of its L0 block descriptor.
+ *
+ * Parameters
+ *   l0_idx		Index of the L0 region.
+ *   l0_desc		Value of the L0 descriptor of the region.
+ *
+ * Return
+ *   True if the L1 table of the region is to be allocated on demand.
+ */
+static bool gpt_is_l0_lazy(unsigned int l0_idx, uint64_t l0_desc)
+{
+	gpt_lazy_l1_info_t *info = gpt_lazy_l1_info;
+
+	if (info == NULL) {
+		return false;
+	}
+
+	return ((info->l0_lazy[l0_idx >> 6U] & (1UL << (l0_idx & 63U))) != 0UL) &&
+	       (GPT_L0_TYPE(l0_desc) == GPT_L0_TYPE_BLK_DESC);
 }
+#endif /* RME_GPT_LAZY_L1 */
 
 /*
- * This function iterates over all of the PAS regions and checks them to ensure
- * proper alignment of base and size, that the GPI is valid, and that no regions
- * overlap. As a part of the overlap checks, this function checks existing L0
- * mappings against the new PAS regions in the event that gpt_init_pas_l1_tables
- * is called multiple times to place L1 tables in different areas of memory. It
- * also counts the number of L1 tables needed and returns it on success.
+ * This function iterates over all of the PAS regions, which must be sorted by
+ * base address, and checks them to ensure proper alignment of base and size,
+ * that the GPI is valid, and that no regions overlap. As a part of the overlap
+ * checks, this function checks existing L0 mappings against the new PAS regions
+ * in the event that gpt_init_pas_l1_tables is called multiple times to place L1
+ * tables in different areas of memory. It also counts the number of L1 tables
+ * needed and returns it on success.
  *
  * Parameters
  *   *pas_regions	Pointer to array of PAS region structures.
@@ -191,19 +275,18 @@ static int gpt_validate_pas_mappings(pas_region_t *pas_regions,
 		}
 
 		/*
-		 * Make sure this PAS does not overlap with another one. We
-		 * start from idx + 1 instead of 0 since prior PAS mappings will
-		 * have already checked themselves against this one.
+		 * Make sure this PAS does not overlap with another one. As the
+		 * regions are sorted by base address, only the previous one
+		 * needs to be checked.
 		 */
-		for (unsigned int i = idx + 1; i < pas_region_cnt; i++) {
-			if (gpt_check_pas_overlap(pas_regions[idx].base_pa,
-			    pas_regions[idx].size,
-			    pas_regions[i].base_pa,
-			    pas_regions[i].size)) {
-				ERROR("[GPT] PAS[%u] overlaps with PAS[%u]\n",
-					i, idx);
-				return -EFAULT;
-			}
+		if ((idx != 0U) &&
+		    gpt_check_pas_overlap(pas_regions[idx - 1U].base_pa,
+					  pas_regions[idx - 1U].size,
+					  pas_regions[idx].base_pa,
+					  pas_regions[idx].size)) {
+			ERROR("[GPT] PAS[%u] overlaps with PAS[%u]\n",
+			      idx, idx - 1U);
+			return -EFAULT;
 		}
 
 		/*
@@ -263,32 +346,28 @@ static int gpt_validate_pas_mappings(pas_region_t *pas_regions,
 			/*
 			 * This creates a situation where, if multiple PAS
 			 * regions occupy the same table descriptor, we can get
-			 * an artificially high total L1 table count. The way we
-			 * handle this is by checking each PAS against those
-			 * before it in the array, and if they both occupy the
-			 * same PAS we subtract from pas_l1_cnt and only the
-			 * first PAS in the array gets to count it.
+			 * an artificially high total L1 table count. As the
+			 * regions are sorted and do not overlap, only the
+			 * previous PAS can share an L0 region with this one,
+			 * and only the first L0 region of this one. In that
+			 * case the previous PAS has already counted it.
 			 */
+			if ((idx != 0U) &&
+			    (GPT_L0_IDX(pas_regions[idx - 1U].base_pa +
+					pas_regions[idx - 1U].size - 1) ==
+			     GPT_L0_IDX(pas_regions[idx].base_pa))) {
+				pas_l1_cnt = pas_l1_cnt - 1;
+			}
 
+#if RME_GPT_LAZY_L1
 			/*
-			 * If L1 count is greater than 1 we know the start and
-			 * end PAs are in different L0 regions so we must check
-			 * both for overlap against other PAS.
+			 * L0 regions entirely covered by this PAS are not
+			 * shared with any other PAS, and only get an L1 table
+			 * on demand at runtime.
 			 */
-			if (pas_l1_cnt > 1) {
-				if (gpt_does_previous_pas_exist_here(
-				    GPT_L0_IDX(pas_regions[idx].base_pa +
-				    pas_regions[idx].size - 1),
-				    pas_regions, idx)) {
-					pas_l1_cnt = pas_l1_cnt - 1;
-				}
-			}
-
-			if (gpt_does_previous_pas_exist_here(
-			    GPT_L0_IDX(pas_regions[idx].base_pa),
-			    pas_regions, idx)) {
-				pas_l1_cnt = pas_l1_cnt - 1;
-			}
+			pas_l1_cnt -= gpt_get_full_l0_cnt(pas_regions[idx].base_pa,
+							  pas_regions[idx].size);
+#endif
 
 			l1_cnt += pas_l1_cnt;
 			continue;
@@ -482,8 +561,27 @@ static uintptr_t gpt_get_l1_end_pa(uintptr_t cur_pa, uintptr_t end_pa)
 }
 
 /*
- * Helper function to fill out GPI entries in a single L1 table. This function
- * fills out entire L1 descriptors at a time to save memory writes.
+ * Helper function to set the GPI of some of the granules described by an L1
+ * descriptor, which must all be GPI_ANY.
+ *
+ * Parameters
+ *   *desc		Pointer to the L1 descriptor.
+ *   gpi_mask		Mask of the GPI fields to set.
+ *   gpi_field		L1 descriptor with every GPI field set to the GPI.
+ */
+static inline void gpt_fill_l1_desc(uint64_t *desc, uint64_t gpi_mask,
+				    uint64_t gpi_field)
+{
+	assert((*desc & gpi_mask) ==
+	       (GPT_BUILD_L1_DESC(GPT_GPI_ANY) & gpi_mask));
+	*desc = (*desc & ~gpi_mask) | (gpi_field & gpi_mask);
+}
+
+/*
+ * Helper function to fill out GPI entries in a single L1 table. Only the L1
+ * descriptors at either end of the range can be partially covered and need a
+ * masked update, the ones in between are written whole with back-to-back
+ * stores.
  *
  * Parameters
  *   gpi		GPI to set this range to
@@ -495,7 +593,10 @@ static void gpt_fill_l1_tbl(uint64_t gpi, uint64_t *l1, uintptr_t first,
 			    uintptr_t last)
 {
 	uint64_t gpi_field = GPT_BUILD_L1_DESC(gpi);
-	uint64_t gpi_mask = 0xFFFFFFFFFFFFFFFF;
+	unsigned int first_idx = GPT_L1_IDX(gpt_config.p, first);
+	unsigned int end_idx = GPT_L1_IDX(gpt_config.p, last) + 1U;
+	uint64_t first_mask;
+	uint64_t last_mask;
 
 	assert(first <= last);
 	assert((first & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) == 0U);
@@ -503,25 +604,30 @@ static void gpt_fill_l1_tbl(uint64_t gpi, uint64_t *l1, uintptr_t first,
 	assert(GPT_L0_IDX(first) == GPT_L0_IDX(last));
 	assert(l1 != NULL);
 
-	/* Shift the mask if we're starting in the middle of an L1 entry. */
-	gpi_mask = gpi_mask << (GPT_L1_GPI_IDX(gpt_config.p, first) << 2);
+	/* Masks of the granules in range in the first and last descriptors. */
+	first_mask = ~0UL << (GPT_L1_GPI_IDX(gpt_config.p, first) << 2);
+	last_mask = ~0UL >> ((15U - GPT_L1_GPI_IDX(gpt_config.p, last)) << 2);
 
-	/* Fill out each L1 entry for this region. */
-	for (unsigned int i = GPT_L1_IDX(gpt_config.p, first);
-	     i <= GPT_L1_IDX(gpt_config.p, last); i++) {
-		/* Account for stopping in the middle of an L1 entry. */
-		if (i == GPT_L1_IDX(gpt_config.p, last)) {
-			gpi_mask &= (gpi_mask >> ((15 -
-				    GPT_L1_GPI_IDX(gpt_config.p, last)) << 2));
-		}
+	if ((first_idx + 1U) == end_idx) {
+		gpt_fill_l1_desc(&l1[first_idx], first_mask & last_mask,
+				 gpi_field);
+		return;
+	}
 
-		/* Write GPI values. */
-		assert((l1[i] & gpi_mask) ==
-		       (GPT_BUILD_L1_DESC(GPT_GPI_ANY) & gpi_mask));
-		l1[i] = (l1[i] & ~gpi_mask) | (gpi_mask & gpi_field);
+	/* Account for starting or stopping in the middle of an L1 entry. */
+	if (first_mask != ~0UL) {
+		gpt_fill_l1_desc(&l1[first_idx], first_mask, gpi_field);
+		first_idx++;
+	}
+	if (last_mask != ~0UL) {
+		end_idx--;
+		gpt_fill_l1_desc(&l1[end_idx], last_mask, gpi_field);
+	}
 
-		/* Reset mask. */
-		gpi_mask = 0xFFFFFFFFFFFFFFFF;
+	/* Write GPI values of whole L1 entries. */
+	for (unsigned int i = first_idx; i < end_idx; i++) {
+		assert(l1[i] == GPT_BUILD_L1_DESC(GPT_GPI_ANY));
+		l1[i] = gpi_field;
 	}
 }
 
@@ -590,6 +696,29 @@ static void gpt_generate_l0_tbl_desc(pas_region_t *pas)
 	     l0_idx <= GPT_L0_IDX(end_pa - 1U);
 	     l0_idx++) {
 
+#if RME_GPT_LAZY_L1
+		/*
+		 * An L0 region entirely covered by this PAS is described by a
+		 * block descriptor until one of its granules is transitioned.
+		 */
+		if (GPT_IS_L0_ALIGNED(cur_pa) &&
+		    ((gpt_get_l1_end_pa(cur_pa, end_pa) - cur_pa) ==
+		     GPT_L0_REGION_SIZE)) {
+			l0_gpt_base[l0_idx] =
+				GPT_L0_BLK_DESC(GPT_PAS_ATTR_GPI(pas->attrs));
+			gpt_lazy_l1_info->l0_lazy[l0_idx >> 6U] |=
+				1UL << (l0_idx & 63U);
+
+			VERBOSE("[GPT] L0 entry (ON-DEMAND) index %u [%p]: GPI = 0x%x (0x%" PRIx64 ")\n",
+				l0_idx, &l0_gpt_base[l0_idx],
+				GPT_PAS_ATTR_GPI(pas->attrs),
+				l0_gpt_base[l0_idx]);
+
+			cur_pa += GPT_L0_REGION_SIZE;
+			continue;
+		}
+#endif
+
 		/*
 		 * See if the L0 entry is already a table descriptor or if we
 		 * need to create one.
@@ -631,10 +760,10 @@ static void gpt_generate_l0_tbl_desc(pas_region_t *pas)
 
 /*
  * This function flushes a range of L0 descriptors used by a given PAS region
- * array. There is a chance that some unmodified L0 descriptors would be flushed
- * in the case that there are "holes" in an array of PAS regions but overall
- * this should be faster than individually flushing each modified L0 descriptor
- * as they are created.
+ * array, which must be sorted by base address. There is a chance that some
+ * unmodified L0 descriptors would be flushed in the case that there are "holes"
+ * in an array of PAS regions but overall this should be faster than
+ * individually flushing each modified L0 descriptor as they are created.
  *
  * Parameters
  *   *pas		Pointer to an array of PAS regions.
@@ -642,7 +771,6 @@ static void gpt_generate_l0_tbl_desc(pas_region_t *pas)
  */
 static void flush_l0_for_pas_array(pas_region_t *pas, unsigned int pas_count)
 {
-	unsigned int idx;
 	unsigned int start_idx;
 	unsigned int end_idx;
 	uint64_t *l0 = (uint64_t *)gpt_config.plat_gpt_l0_base;
@@ -650,19 +778,13 @@ static void flush_l0_for_pas_array(pas_region_t *pas, unsigned int pas_count)
 	assert(pas != NULL);
 	assert(pas_count > 0);
 
-	/* Initial start and end values. */
+	/*
+	 * The lowest and highest L0 indices used in this PAS array belong to
+	 * the first and last regions.
+	 */
 	start_idx = GPT_L0_IDX(pas[0].base_pa);
-	end_idx = GPT_L0_IDX(pas[0].base_pa + pas[0].size - 1);
-
-	/* Find lowest and highest L0 indices used in this PAS array. */
-	for (idx = 1; idx < pas_count; idx++) {
-		if (GPT_L0_IDX(pas[idx].base_pa) < start_idx) {
-			start_idx = GPT_L0_IDX(pas[idx].base_pa);
-		}
-		if (GPT_L0_IDX(pas[idx].base_pa + pas[idx].size - 1) > end_idx) {
-			end_idx = GPT_L0_IDX(pas[idx].base_pa + pas[idx].size - 1);
-		}
-	}
+	end_idx = GPT_L0_IDX(pas[pas_count - 1].base_pa +
+			     pas[pas_count - 1].size - 1);
 
 	/*
 	 * Flush all covered L0 descriptors, add 1 because we need to include
@@ -672,6 +794,497 @@ static void flush_l0_for_pas_array(pas_region_t *pas, unsigned int pas_count)
 			   ((end_idx + 1) - start_idx) * sizeof(uint64_t));
 }
 
+/*
+ * Lookup of the block sizes, expressed as log2, that a single TLBI RPALOS can
+ * invalidate, indexed by the encoding of the SIZE field of the instruction.
+ */
+static const unsigned char gpt_tlbi_rpa_sz_lookup[] = {
+	12U,	/* TLBI_RPA_SZ_4KB */
+	14U,	/* TLBI_RPA_SZ_16KB */
+	16U,	/* TLBI_RPA_SZ_64KB */
+	21U,	/* TLBI_RPA_SZ_2MB */
+	25U,	/* TLBI_RPA_SZ_32MB */
+	29U,	/* TLBI_RPA_SZ_512MB */
+	30U,	/* TLBI_RPA_SZ_1GB */
+	34U,	/* TLBI_RPA_SZ_16GB */
+	36U,	/* TLBI_RPA_SZ_64GB */
+	39U	/* TLBI_RPA_SZ_512GB */
+};
+
+/*
+ * Helper to invalidate the GPT TLB entries, last level, for a range of
+ * physical addresses. The range is covered with the smallest possible number
+ * of TLBI RPALOS operations by always using the largest naturally aligned
+ * block that fits in what is left of the range. The caller is responsible for
+ * the barriers that complete the invalidation.
+ *
+ * Parameters
+ *   base		Base address of the range, must be granule-aligned.
+ *   size		Size of the range, must be granule-aligned.
+ */
+static void gpt_tlbi_by_pa_ll(uint64_t base, size_t size)
+{
+	uint64_t end = base + size;
+	unsigned int sz;
+
+	assert(GPT_IS_L1_ALIGNED(gpt_config.p, base));
+	assert(GPT_IS_L1_ALIGNED(gpt_config.p, size));
+
+	while (base < end) {
+		sz = ARRAY_SIZE(gpt_tlbi_rpa_sz_lookup) - 1U;
+		while ((sz > TLBI_RPA_SZ_4KB) &&
+		       (((base & ((1UL << gpt_tlbi_rpa_sz_lookup[sz]) - 1UL)) != 0UL) ||
+			((end - base) < (1UL << gpt_tlbi_rpa_sz_lookup[sz])))) {
+			sz--;
+		}
+
+		tlbirpalos(TLBI_RPA(base, (uint64_t)sz));
+		base += 1UL << gpt_tlbi_rpa_sz_lookup[sz];
+	}
+}
+
+/*
+ * Helper to get the L1 table covering a physical address.
+ *
+ * Return
+ *   Pointer to the L1 table, or NULL if the address is not covered by an L0
+ *   table descriptor.
+ */
+static uint64_t *gpt_get_l1_tbl(uint64_t pa)
+{
+	uint64_t gpt_l0_desc = ((uint64_t *)gpt_config.plat_gpt_l0_base)[GPT_L0_IDX(pa)];
+
+	if (GPT_L0_TYPE(gpt_l0_desc) != GPT_L0_TYPE_TBL_DESC) {
+		VERBOSE("[GPT] Granule is not covered by a table descriptor!\n");
+		VERBOSE("      Base=0x%" PRIx64 "\n", pa);
+		return NULL;
+	}
+
+	return GPT_L0_TBLD_ADDR(gpt_l0_desc);
+}
+
+/*
+ * The L1 descriptors are protected by an array of spinlocks to ensure that
+ * multiple CPUs do not attempt to change the same descriptors at once, while
+ * transitions on disjoint PA ranges can proceed in parallel. Each lock sits in
+ * its own cache line, together with the number of times a CPU found it held
+ * by another one.
+ */
+typedef struct {
+	spinlock_t lock;
+	uint64_t contended;
+} __aligned(CACHE_WRITEBACK_GRANULE) gpt_lock_t;
+
+static gpt_lock_t gpt_locks[GPT_LOCK_COUNT];
+
+CASSERT(GPT_LOCK_COUNT == 64U, assert_gpt_lock_count_fits_lock_mask);
+CASSERT(GPT_LOCK_BLOCK_SHIFT >= GPT_L1_IDX_SHIFT(PGS_64KB_P),
+	assert_gpt_lock_block_covers_l1_desc);
+
+/*
+ * Helper to get the mask of the locks protecting a range of granules.
+ *
+ * Parameters
+ *   base		Base address of the range.
+ *   size		Size of the range, must not be zero.
+ *
+ * Return
+ *   Lock mask, bit n being set if gpt_locks[n] protects part of the range.
+ */
+static uint64_t gpt_get_lock_mask(uint64_t base, size_t size)
+{
+	uint64_t first = base >> GPT_LOCK_BLOCK_SHIFT;
+	uint64_t last = (base + size - 1UL) >> GPT_LOCK_BLOCK_SHIFT;
+	uint64_t mask = 0UL;
+
+	if ((last - first) >= (GPT_LOCK_COUNT - 1U)) {
+		return ~0UL;
+	}
+
+	for (uint64_t blk = first; blk <= last; blk++) {
+		mask |= 1UL << (blk & (GPT_LOCK_COUNT - 1U));
+	}
+
+	return mask;
+}
+
+/*
+ * Acquire every lock in a lock mask. Locks are always taken in increasing
+ * order so that CPUs locking overlapping masks cannot deadlock. A lock found
+ * held by another CPU is accounted for in its contention counter. The lock
+ * word is read before trying to take the lock, so that a spurious failure of
+ * the exclusive store in spin_trylock() is not counted. A lock taken by
+ * another CPU between the read and the attempt is not counted either, so the
+ * counters are a lower bound.
+ *
+ * Return
+ *   Number of locks that were found held by another CPU.
+ */
+static unsigned int gpt_lock(uint64_t mask)
+{
+	unsigned int waits = 0U;
+	unsigned int idx;
+
+	while (mask != 0UL) {
+		idx = (unsigned int)__builtin_ctzll(mask);
+		mask &= mask - 1UL;
+
+		if (gpt_locks[idx].lock.lock != 0U) {
+			spin_lock(&gpt_locks[idx].lock);
+			gpt_locks[idx].contended++;
+			waits++;
+		} else if (!spin_trylock(&gpt_locks[idx].lock)) {
+			spin_lock(&gpt_locks[idx].lock);
+		}
+	}
+
+	return waits;
+}
+
+/*
+ * Release every lock in a lock mask.
+ */
+static void gpt_unlock(uint64_t mask)
+{
+	unsigned int idx;
+
+	while (mask != 0UL) {
+		idx = (unsigned int)__builtin_ctzll(mask);
+		mask &= mask - 1UL;
+
+		spin_unlock(&gpt_locks[idx].lock);
+	}
+}
+
+#if GPT_L1_CONTIG_MAX != 0
+/*
+ * Helper to split the contiguous block that the L1 descriptor covering pa
+ * belongs to. A block described with a given Contig value is rewritten with
+ * descriptors of the next smaller Contig value, or with granules descriptors
+ * for 2MB blocks, all carrying the same GPI. As GPIs are unchanged, accesses
+ * remain valid throughout, and the block is invalidated from the TLBs once
+ * the descriptors have been written.
+ *
+ * Parameters
+ *   l1			L1 table covering pa.
+ *   pa			Address within the contiguous block to split.
+ */
+static void gpt_shatter_block(uint64_t *l1, uint64_t pa)
+{
+	uint64_t desc = l1[GPT_L1_IDX(gpt_config.p, pa)];
+	unsigned int contig = GPT_L1_CONT_CONTIG(desc);
+	unsigned int gpi = GPT_L1_CONT_GPI(desc);
+	size_t blk_size = GPT_L1_CONT_SIZE(contig);
+	uint64_t blk_base = pa & ~(blk_size - 1UL);
+	unsigned int first = GPT_L1_IDX(gpt_config.p, blk_base);
+	unsigned int cnt = blk_size >> GPT_L1_IDX_SHIFT(gpt_config.p);
+	uint64_t new_desc;
+
+	assert(GPT_L1_IS_CONT_DESC(desc));
+	assert((contig != 0U) && (contig <= GPT_L1_CONTIG_MAX));
+
+	if (contig == GPT_L1_CONTIG_2MB) {
+		new_desc = GPT_BUILD_L1_DESC(gpi);
+	} else {
+		new_desc = GPT_L1_CONT_DESC(gpi, contig - 1U);
+	}
+
+	for (unsigned int i = first; i < (first + cnt); i++) {
+		l1[i] = new_desc;
+	}
+	dsboshst();
+
+	gpt_tlbi_by_pa_ll(blk_base, blk_size);
+	dsbosh();
+
+	VERBOSE("[GPT] Split block 0x%" PRIx64 " - 0x%" PRIx64 ", GPI 0x%x\n",
+		blk_base, blk_base + blk_size - 1UL, gpi);
+}
+
+/*
+ * This function makes sure that a range of granules is only described by
+ * granules descriptors, so that their GPIs can be changed individually, by
+ * splitting any contiguous block overlapping the range.
+ *
+ * Parameters
+ *   base		Base address of the range, must be granule-aligned.
+ *   size		Size of the range, must be granule-aligned.
+ */
+static void gpt_shatter_range(uint64_t base, size_t size)
+{
+	uint64_t end_pa = base + size;
+	uint64_t cur_pa = base;
+	uint64_t *l1;
+
+	while (cur_pa < end_pa) {
+		l1 = gpt_get_l1_tbl(cur_pa);
+		assert(l1 != NULL);
+
+		do {
+			while (GPT_L1_IS_CONT_DESC(l1[GPT_L1_IDX(gpt_config.p,
+								 cur_pa)])) {
+				gpt_shatter_block(l1, cur_pa);
+			}
+
+			/* Move to the first granule of the next descriptor. */
+			cur_pa = (cur_pa |
+				  (GPT_L1_DESC_ACTUAL_SIZE(gpt_config.p) - 1UL)) + 1UL;
+		} while ((cur_pa < end_pa) && !GPT_IS_L0_ALIGNED(cur_pa));
+	}
+}
+
+/*
+ * Helper to check whether a block of memory can be described with contiguous
+ * descriptors of a given Contig value, which requires every granule in the
+ * block to have the same GPI. For a 2MB block this requires uniform granules
+ * descriptors, for larger blocks it requires contiguous descriptors of the next
+ * smaller Contig value.
+ *
+ * Parameters
+ *   l1			L1 table covering the block.
+ *   blk_base		Base address of the block, aligned to its size.
+ *   contig		Contig value of the block.
+ *   *gpi		Updated with the GPI of the block if it can be fused.
+ *
+ * Return
+ *   True if the block can be fused, false otherwise.
+ */
+static bool gpt_is_block_fusable(const uint64_t *l1, uint64_t blk_base,
+				 unsigned int contig, unsigned int *gpi)
+{
+	unsigned int first = GPT_L1_IDX(gpt_config.p, blk_base);
+	unsigned int cnt = GPT_L1_CONT_SIZE(contig) >>
+			   GPT_L1_IDX_SHIFT(gpt_config.p);
+	uint64_t desc = l1[first];
+
+	if (contig == GPT_L1_CONTIG_2MB) {
+		if (GPT_L1_IS_CONT_DESC(desc)) {
+			return false;
+		}
+		*gpi = (unsigned int)(desc & GPT_L1_GRAN_DESC_GPI_MASK);
+		if (desc != GPT_BUILD_L1_DESC(*gpi)) {
+			return false;
+		}
+	} else {
+		if (!GPT_L1_IS_CONT_DESC(desc) ||
+		    (GPT_L1_CONT_CONTIG(desc) != (contig - 1U))) {
+			return false;
+		}
+		*gpi = GPT_L1_CONT_GPI(desc);
+	}
+
+	for (unsigned int i = first + 1U; i < (first + cnt); i++) {
+		if (l1[i] != desc) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Helper to describe a block of memory with contiguous descriptors of a given
+ * Contig value, if every granule in the block has the same GPI. As GPIs are
+ * unchanged, accesses remain valid throughout, and the block is invalidated
+ * from the TLBs once the descriptors have been written if the tables are in
+ * use.
+ *
+ * Parameters
+ *   l1			L1 table covering the block.
+ *   blk_base		Base address of the block, aligned to its size.
+ *   contig		Contig value of the block.
+ *   tlbi		Whether TLB maintenance is needed.
+ *
+ * Return
+ *   True if the block has been fused, false otherwise.
+ */
+static bool gpt_fuse_block(uint64_t *l1, uint64_t blk_base,
+			   unsigned int contig, bool tlbi)
+{
+	unsigned int first = GPT_L1_IDX(gpt_config.p, blk_base);
+	size_t blk_size = GPT_L1_CONT_SIZE(contig);
+	unsigned int cnt = blk_size >> GPT_L1_IDX_SHIFT(gpt_config.p);
+	unsigned int gpi;
+	uint64_t desc;
+
+	if (!gpt_is_block_fusable(l1, blk_base, contig, &gpi)) {
+		return false;
+	}
+
+	desc = GPT_L1_CONT_DESC(gpi, contig);
+	for (unsigned int i = first; i < (first + cnt); i++) {
+		l1[i] = desc;
+	}
+
+	if (tlbi) {
+		dsboshst();
+		gpt_tlbi_by_pa_ll(blk_base, blk_size);
+		dsbosh();
+	}
+
+	return true;
+}
+
+/*
+ * This function describes the contiguous blocks overlapping a range of
+ * granules with contiguous descriptors wherever possible, starting with 2MB
+ * blocks and going up to the largest block size in use. A larger block can
+ * only be fused if one of the smaller blocks it contains has just been.
+ *
+ * At runtime, fusing a block rewrites all its descriptors, so the locks
+ * covering the block are needed. Blocks are checked before their locks are
+ * taken, as most of them cannot be fused, and checked again once the locks are
+ * held. Missing locks are taken after releasing the held ones, so that locks
+ * are always taken in order.
+ *
+ * Parameters
+ *   base		Base address of the range, must be granule-aligned.
+ *   size		Size of the range, must be granule-aligned.
+ *   *lock_mask		Mask of the locks held by the caller, updated with the
+ *			locks taken, or NULL at boot when the tables are not in
+ *			use yet and neither locks nor TLB maintenance are
+ *			needed.
+ *
+ * Return
+ *   Number of locks that were found held by another CPU.
+ */
+static unsigned int gpt_fuse_range(uint64_t base, size_t size,
+				   uint64_t *lock_mask)
+{
+	uint64_t end_pa = base + size;
+	uint64_t blk_size;
+	uint64_t mask;
+	uint64_t pa;
+	uint64_t *l1;
+	unsigned int waits = 0U;
+	unsigned int gpi;
+	bool fused = true;
+
+	for (unsigned int contig = GPT_L1_CONTIG_2MB;
+	     (contig <= GPT_L1_CONTIG_MAX) && fused; contig++) {
+		fused = false;
+		blk_size = GPT_L1_CONT_SIZE(contig);
+
+		for (pa = base & ~(blk_size - 1UL); pa < end_pa;
+		     pa += blk_size) {
+#if RME_GPT_LAZY_L1
+			/* Regions without L1 table yet are uniform. */
+			if (gpt_is_l0_lazy(GPT_L0_IDX(pa),
+			    ((uint64_t *)gpt_config.plat_gpt_l0_base)[GPT_L0_IDX(pa)])) {
+				continue;
+			}
+#endif
+			/* Blocks never cross L0 regions of the range. */
+			l1 = gpt_get_l1_tbl(pa);
+			assert(l1 != NULL);
+
+			if (!gpt_is_block_fusable(l1, pa, contig, &gpi)) {
+				continue;
+			}
+
+			if (lock_mask != NULL) {
+				mask = gpt_get_lock_mask(pa, blk_size);
+				if ((mask & ~*lock_mask) != 0UL) {
+					gpt_unlock(*lock_mask);
+					*lock_mask |= mask;
+					waits += gpt_lock(*lock_mask);
+				}
+			}
+
+			if (gpt_fuse_block(l1, pa, contig, lock_mask != NULL)) {
+				VERBOSE("[GPT] Fused block 0x%" PRIx64 " - 0x%"
+					PRIx64 "\n", pa, pa + blk_size - 1UL);
+				fused = true;
+			}
+		}
+	}
+
+	return waits;
+}
+
+/*
+ * Helper to get the size of the block of memory whose L1 descriptors are all
+ * rewritten when the granule at pa is split out of it: the contiguous block
+ * containing pa, or the largest contiguous block size for an L0 region waiting
+ * for its L1 table, as the table is filled with such blocks. A granules
+ * descriptor is rewritten alone.
+ *
+ * The descriptors are read without holding the locks covering pa, so the size
+ * is only stable once those locks are held.
+ */
+static size_t gpt_get_split_size(uint64_t pa)
+{
+	uint64_t l0_desc = ((uint64_t *)gpt_config.plat_gpt_l0_base)[GPT_L0_IDX(pa)];
+	uint64_t desc;
+
+#if RME_GPT_LAZY_L1
+	if (gpt_is_l0_lazy(GPT_L0_IDX(pa), l0_desc)) {
+		return GPT_L1_CONT_SIZE(GPT_L1_CONTIG_MAX);
+	}
+#endif
+	if (GPT_L0_TYPE(l0_desc) != GPT_L0_TYPE_TBL_DESC) {
+		return GPT_PGS_ACTUAL_SIZE(gpt_config.p);
+	}
+
+	desc = GPT_L0_TBLD_ADDR(l0_desc)[GPT_L1_IDX(gpt_config.p, pa)];
+	if (GPT_L1_IS_CONT_DESC(desc)) {
+		return GPT_L1_CONT_SIZE(GPT_L1_CONT_CONTIG(desc));
+	}
+
+	return GPT_PGS_ACTUAL_SIZE(gpt_config.p);
+}
+#endif /* GPT_L1_CONTIG_MAX != 0 */
+
+/*
+ * Acquire the locks protecting a range of granules for a transition. With
+ * contiguous descriptors, the blocks overlapping either end of the range are
+ * split as a whole, so their locks are taken as well. Their size is read
+ * before the locks are taken, so it is read again once the locks are held, and
+ * the locks are taken again in the unlikely event that a block has been fused
+ * in the meantime.
+ *
+ * Parameters
+ *   base		Base address of the range, must be granule-aligned.
+ *   size		Size of the range, must not be zero.
+ *   *lock_mask		Updated with the mask of the locks taken.
+ *
+ * Return
+ *   Number of locks that were found held by another CPU.
+ */
+static unsigned int gpt_lock_range(uint64_t base, size_t size,
+				   uint64_t *lock_mask)
+{
+	uint64_t mask = gpt_get_lock_mask(base, size);
+	unsigned int waits;
+#if GPT_L1_CONTIG_MAX != 0
+	uint64_t last = base + size - 1UL;
+	uint64_t first;
+	uint64_t held = 0UL;
+
+	waits = 0U;
+	for (;;) {
+		first = base & ~(gpt_get_split_size(base) - 1UL);
+		mask |= gpt_get_lock_mask(first, (last |
+					  (gpt_get_split_size(last) - 1UL)) -
+					  first + 1UL);
+		if (mask == held) {
+			break;
+		}
+
+		if (held != 0UL) {
+			gpt_unlock(held);
+		}
+		waits += gpt_lock(mask);
+		held = mask;
+	}
+#else
+	waits = gpt_lock(mask);
+#endif
+
+	*lock_mask = mask;
+	return waits;
+}
+
 /*
  * Public API to enable granule protection checks once the tables have all been
  * initialized. This function is called at first initialization and then again
@@ -767,6 +1380,7 @@ int gpt_init_l0_tables(gpccr_pps_e pps, uintptr_t l0_mem_base,
 {
 	int ret;
 	uint64_t gpt_desc;
+	uint64_t start = read_cntpct_el0();
 
 	/* Ensure that MMU and Data caches are enabled. */
 	assert((read_sctlr_el3() & SCTLR_C_BIT) != 0U);
@@ -789,9 +1403,16 @@ int gpt_init_l0_tables(gpccr_pps_e pps, uintptr_t l0_mem_base,
 	flush_dcache_range((uintptr_t)l0_mem_base,
 			   (size_t)GPT_L0_TABLE_SIZE(gpt_config.t));
 
-	/* Stash the L0 base address once initial setup is complete. */
+#if RME_GPT_LAZY_L1
+	/* The next call to gpt_init_pas_l1_tables() sets up the pool. */
+	gpt_lazy_l1_info = NULL;
+#endif
+
+	/* Stash the L0 base address once initial setup is complete. */
 	gpt_config.plat_gpt_l0_base = l0_mem_base;
 
+	gpt_setup_ticks = read_cntpct_el0() - start;
+
 	return 0;
 }
 
@@ -810,7 +1431,10 @@ int gpt_init_l0_tables(gpccr_pps_e pps, uintptr_t l0_mem_base,
  *   pgs		PGS value to use for table generation.
  *   l1_mem_base	Base address of memory used for L1 tables.
  *   l1_mem_size	Total size of memory available for L1 tables.
- *   *pas_regions	Pointer to PAS regions structure array.
+ *   *pas_regions	Pointer to PAS regions structure array. The array is
+ *			sorted in place by base address, so it must be
+ *			writable, not in read-only memory, and its original
+ *			order is not preserved.
  *   pas_count		Total number of PAS regions.
  *
  * Return
@@ -822,6 +1446,14 @@ int gpt_init_pas_l1_tables(gpccr_pgs_e pgs, uintptr_t l1_mem_base,
 {
 	int ret;
 	int l1_gpt_cnt;
+	uint64_t start = read_cntpct_el0();
+	uint64_t freq;
+#if RME_GPT_LAZY_L1
+	gpt_l1_pool_range_t *pool;
+	uintptr_t info_addr;
+	bool first_call = false;
+	size_t pool_cnt;
+#endif
 
 	/* Ensure that MMU and Data caches are enabled. */
 	assert((read_sctlr_el3() & SCTLR_C_BIT) != 0U);
@@ -840,6 +1472,33 @@ int gpt_init_pas_l1_tables(gpccr_pgs_e pgs, uintptr_t l1_mem_base,
 		return -EPERM;
 	}
 
+#if RME_GPT_LAZY_L1
+	/*
+	 * The first call keeps the on-demand L1 table information at the end
+	 * of its L1 memory, which is not available for L1 tables any more.
+	 */
+	if (gpt_lazy_l1_info == NULL) {
+		info_addr = gpt_get_lazy_l1_info_addr(l1_mem_base, l1_mem_size);
+		if (info_addr == 0U) {
+			ERROR("[GPT] Inadequate L1 memory for on-demand L1 GPTs\n");
+			return -ENOMEM;
+		}
+
+		gpt_lazy_l1_info = (gpt_lazy_l1_info_t *)info_addr;
+		(void)memset(gpt_lazy_l1_info, 0,
+			     GPT_LAZY_L1_INFO_SIZE(gpt_config.t));
+		l1_mem_size = info_addr - l1_mem_base;
+		first_call = true;
+	}
+#endif
+
+	/*
+	 * Sort the PAS regions so that they can be validated and the tables
+	 * generated in a single pass over them.
+	 */
+	assert(pas_regions != NULL);
+	gpt_sort_pas_regions(pas_regions, pas_count);
+
 	/* Check if L1 GPTs are required and how many. */
 	l1_gpt_cnt = gpt_validate_pas_mappings(pas_regions, pas_count);
 	if (l1_gpt_cnt < 0) {
@@ -848,8 +1507,12 @@ int gpt_init_pas_l1_tables(gpccr_pgs_e pgs, uintptr_t l1_mem_base,
 
 	VERBOSE("[GPT] %u L1 GPTs requested.\n", l1_gpt_cnt);
 
-	/* If L1 tables are needed then validate the L1 parameters. */
-	if (l1_gpt_cnt > 0) {
+	/*
+	 * If L1 tables are needed then validate the L1 parameters. With
+	 * on-demand L1 tables, the L1 memory not used at boot is used at
+	 * runtime, so it is validated even if no table is needed now.
+	 */
+	if ((l1_gpt_cnt > 0) || ((RME_GPT_LAZY_L1 != 0) && (l1_mem_size != 0U))) {
 		ret = gpt_validate_l1_params(l1_mem_base, l1_mem_size,
 		      l1_gpt_cnt);
 		if (ret != 0) {
@@ -885,6 +1548,17 @@ int gpt_init_pas_l1_tables(gpccr_pgs_e pgs, uintptr_t l1_mem_base,
 		}
 	}
 
+#if GPT_L1_CONTIG_MAX != 0
+	/* Describe granule-mapped regions with contiguous descriptors. */
+	for (unsigned int idx = 0U; idx < pas_count; idx++) {
+		if (GPT_PAS_ATTR_MAP_TYPE(pas_regions[idx].attrs) ==
+		    GPT_PAS_ATTR_MAP_TYPE_GRANULE) {
+			(void)gpt_fuse_range(pas_regions[idx].base_pa,
+					     pas_regions[idx].size, NULL);
+		}
+	}
+#endif
+
 	/* Flush modified L0 tables. */
 	flush_l0_for_pas_array(pas_regions, pas_count);
 
@@ -895,12 +1569,48 @@ int gpt_init_pas_l1_tables(gpccr_pgs_e pgs, uintptr_t l1_mem_base,
 				   l1_gpt_cnt);
 	}
 
+#if RME_GPT_LAZY_L1
+	/*
+	 * The L1 memory left over by the first call makes up the pool that
+	 * on-demand L1 tables are taken from. This is the only L1 memory the
+	 * runtime stage is told about, so that it can validate the pool.
+	 */
+	pool_cnt = (l1_mem_size / GPT_L1_TABLE_SIZE(gpt_config.p)) -
+		   (size_t)l1_gpt_cnt;
+	if (first_call) {
+		pool = &gpt_lazy_l1_info->pool;
+		pool->base = l1_mem_base +
+			     (GPT_L1_TABLE_SIZE(gpt_config.p) * l1_gpt_cnt);
+		pool->cnt = (unsigned int)pool_cnt;
+		pool->next = 0U;
+
+		if (pool_cnt != 0U) {
+			INFO("[GPT] %u L1 GPTs available on demand\n",
+			     pool->cnt);
+		}
+	} else if (pool_cnt != 0U) {
+		WARN("[GPT] %u L1 GPTs not available on demand\n",
+		     (unsigned int)pool_cnt);
+	}
+
+	flush_dcache_range((uintptr_t)gpt_lazy_l1_info,
+			   GPT_LAZY_L1_INFO_SIZE(gpt_config.t));
+#endif
+
 	/* Make sure that all the entries are written to the memory. */
 	dsbishst();
 	tlbipaallos();
 	dsb();
 	isb();
 
+	/* Report the time spent building the tables so far. */
+	gpt_setup_ticks += read_cntpct_el0() - start;
+	freq = read_cntfrq_el0();
+	if (freq != 0UL) {
+		INFO("[GPT] Tables built in %" PRIu64 " us\n",
+		     (gpt_setup_ticks * 1000000UL) / freq);
+	}
+
 	return 0;
 }
 
@@ -953,50 +1663,371 @@ int gpt_runtime_init(void)
 	return 0;
 }
 
+#if RME_GPT_LAZY_L1
+/*
+ * Public API to find the information needed to allocate L1 tables on demand,
+ * which a previous stage has kept at the end of the L1 memory supplied to the
+ * first call to gpt_init_pas_l1_tables(). This function must be called after
+ * gpt_runtime_init(), with the same L1 memory as that first call.
+ *
+ * Parameters
+ *   l1_mem_base	Base address of the L1 memory of the first call.
+ *   l1_mem_size	Size of the L1 memory of the first call.
+ *
+ * Return
+ *   Negative Linux error code in the event of a failure, 0 for success.
+ */
+int gpt_runtime_init_l1_pool(uintptr_t l1_mem_base, size_t l1_mem_size)
+{
+	gpt_lazy_l1_info_t *info;
+	gpt_l1_pool_range_t *pool;
+	uintptr_t info_addr;
+	size_t tbl_size;
+
+	if (gpt_config.plat_gpt_l0_base == 0U) {
+		ERROR("[GPT] Runtime configuration must be initialized first!\n");
+		return -EPERM;
+	}
+
+	info_addr = gpt_get_lazy_l1_info_addr(l1_mem_base, l1_mem_size);
+	if (info_addr == 0U) {
+		ERROR("[GPT] Invalid L1 memory: 0x%lx, 0x%lx\n", l1_mem_base,
+		      l1_mem_size);
+		return -EINVAL;
+	}
+
+	/*
+	 * The pool must lie in the L1 memory below the information, so that
+	 * tables allocated at runtime cannot overwrite anything else.
+	 */
+	info = (gpt_lazy_l1_info_t *)info_addr;
+	pool = &info->pool;
+	tbl_size = GPT_L1_TABLE_SIZE(gpt_config.p);
+	if ((pool->next > pool->cnt) ||
+	    ((pool->base & (tbl_size - 1UL)) != 0U) ||
+	    (pool->base < l1_mem_base) || (pool->base > info_addr) ||
+	    (pool->cnt > ((info_addr - pool->base) / tbl_size))) {
+		ERROR("[GPT] Invalid on-demand L1 GPT information at 0x%lx\n",
+		      info_addr);
+		return -EINVAL;
+	}
+
+	gpt_lazy_l1_info = info;
+
+	VERBOSE("  L1 pool:   0x%lx, %u/%u used\n", pool->base, pool->next,
+		pool->cnt);
+
+	return 0;
+}
+#endif /* RME_GPT_LAZY_L1 */
+
 /*
- * The L1 descriptors are protected by a spinlock to ensure that multiple
- * CPUs do not attempt to change the descriptors at once. In the future it
- * would be better to have separate spinlocks for each L1 descriptor.
+ * Public API to get the number of times a granule transition had to wait for
+ * a GPT lock held by another CPU since boot.
+ *
+ * Return
+ *   Total contention count over all GPT locks.
  */
-static spinlock_t gpt_lock;
+uint64_t gpt_get_lock_contention(void)
+{
+	uint64_t total = 0UL;
+
+	for (unsigned int i = 0U; i < GPT_LOCK_COUNT; i++) {
+		total += gpt_locks[i].contended;
+	}
+
+	return total;
+}
 
 /*
- * A helper to write the value (target_pas << gpi_shift) to the index of
- * the gpt_l1_addr
+ * Report the locks a transition had to wait for, once they have been released
+ * so that printing does not hold up other CPUs.
  */
-static inline void write_gpt(uint64_t *gpt_l1_desc, uint64_t *gpt_l1_addr,
-			     unsigned int gpi_shift, unsigned int idx,
-			     unsigned int target_pas)
+static void gpt_report_lock_waits(unsigned int waits)
 {
-	*gpt_l1_desc &= ~(GPT_L1_GRAN_DESC_GPI_MASK << gpi_shift);
-	*gpt_l1_desc |= ((uint64_t)target_pas << gpi_shift);
-	gpt_l1_addr[idx] = *gpt_l1_desc;
+	if (waits != 0U) {
+		VERBOSE("[GPT] Waited for %u lock(s), %" PRIu64 " waits since boot\n",
+			waits, gpt_get_lock_contention());
+	}
 }
 
+#if RME_GPT_LAZY_L1
 /*
- * Helper to retrieve the gpt_l1_* information from the base address
- * returned in gpi_info
+ * On-demand L1 tables are taken from the pool under this lock, which also
+ * serialises the switch of L0 descriptors from block to table, as a single L0
+ * descriptor covers ranges protected by many different L1 descriptor locks.
  */
-static int get_gpi_params(uint64_t base, gpi_info_t *gpi_info)
+static spinlock_t gpt_l1_pool_lock;
+
+/*
+ * This function gives an L1 table to an L0 region described by a block
+ * descriptor since boot. The table is filled with the GPI of the block before
+ * the L0 descriptor is switched to it, so GPIs are unchanged and accesses
+ * remain valid throughout. Nothing is done if another CPU has already
+ * allocated the table.
+ *
+ * Parameters
+ *   l0_idx		Index of the L0 region.
+ *
+ * Return
+ *   -ENOMEM if the pool is exhausted, 0 for success.
+ */
+static int gpt_alloc_l1_tbl(unsigned int l0_idx)
 {
-	uint64_t gpt_l0_desc, *gpt_l0_base;
+	gpt_l1_pool_range_t *pool = &gpt_lazy_l1_info->pool;
+	uint64_t *l0 = (uint64_t *)gpt_config.plat_gpt_l0_base;
+	uint64_t l1_desc;
+	uint64_t *l1;
 
-	gpt_l0_base = (uint64_t *)gpt_config.plat_gpt_l0_base;
-	gpt_l0_desc = gpt_l0_base[GPT_L0_IDX(base)];
-	if (GPT_L0_TYPE(gpt_l0_desc) != GPT_L0_TYPE_TBL_DESC) {
-		VERBOSE("[GPT] Granule is not covered by a table descriptor!\n");
+	spin_lock(&gpt_l1_pool_lock);
+
+	if (!gpt_is_l0_lazy(l0_idx, l0[l0_idx])) {
+		spin_unlock(&gpt_l1_pool_lock);
+		return 0;
+	}
+
+	if (pool->next == pool->cnt) {
+		spin_unlock(&gpt_l1_pool_lock);
+		ERROR("[GPT] No L1 GPT left for L0 region %u!\n", l0_idx);
+		return -ENOMEM;
+	}
+
+	l1 = (uint64_t *)(pool->base +
+			  (GPT_L1_TABLE_SIZE(gpt_config.p) * pool->next));
+	pool->next++;
+
+#if GPT_L1_CONTIG_MAX != 0
+	l1_desc = GPT_L1_CONT_DESC(GPT_L0_BLKD_GPI(l0[l0_idx]),
+				   GPT_L1_CONTIG_MAX);
+#else
+	l1_desc = GPT_BUILD_L1_DESC(GPT_L0_BLKD_GPI(l0[l0_idx]));
+#endif
+	for (unsigned int i = 0U; i < GPT_L1_ENTRY_COUNT(gpt_config.p); i++) {
+		l1[i] = l1_desc;
+	}
+
+	/* Make the L1 table visible before the L0 descriptor pointing to it. */
+	dsboshst();
+	l0[l0_idx] = GPT_L0_TBL_DESC(l1);
+	dsboshst();
+
+	/* Remove the block descriptor from the TLBs. */
+	gpt_tlbi_by_pa_ll((uint64_t)l0_idx << GPT_L0_IDX_SHIFT,
+			  GPT_L0_REGION_SIZE);
+	dsbosh();
+
+	spin_unlock(&gpt_l1_pool_lock);
+
+	VERBOSE("[GPT] L0 entry (TABLE) index %u ==> L1 Addr 0x%lx on demand\n",
+		l0_idx, (uintptr_t)l1);
+
+	return 0;
+}
+
+/*
+ * This function makes sure that every L0 region overlapping a range of
+ * granules is described by an L1 table, so that their GPIs can be changed.
+ *
+ * Parameters
+ *   base		Base address of the range.
+ *   size		Size of the range, must not be zero.
+ *
+ * Return
+ *   Negative Linux error code in the event of a failure, 0 for success.
+ */
+static int gpt_alloc_range_l1_tbls(uint64_t base, size_t size)
+{
+	int res;
+
+	for (unsigned int i = GPT_L0_IDX(base);
+	     i <= GPT_L0_IDX(base + size - 1UL); i++) {
+		res = gpt_alloc_l1_tbl(i);
+		if (res != 0) {
+			return res;
+		}
+	}
+
+	return 0;
+}
+#endif /* RME_GPT_LAZY_L1 */
+
+/*
+ * Helper to get the mask of the GPI fields that a range of granules occupies
+ * within a single L1 descriptor. The range starts at cur_pa and is clipped to
+ * either end_pa or the end of the L1 descriptor, whichever comes first.
+ *
+ * Parameters
+ *   cur_pa		Address of the first granule, must be granule-aligned.
+ *   end_pa		End of the whole range (exclusive).
+ *   *next_pa		Updated with the address following the clipped range.
+ *
+ * Return
+ *   Mask of the GPI fields to update in the L1 descriptor.
+ */
+static uint64_t gpt_get_l1_gpi_mask(uint64_t cur_pa, uint64_t end_pa,
+				    uint64_t *next_pa)
+{
+	unsigned int first = GPT_L1_GPI_IDX(gpt_config.p, cur_pa);
+	unsigned int cnt;
+	uint64_t desc_end;
+
+	/* PA following the last granule described by this L1 descriptor. */
+	desc_end = (cur_pa | (GPT_L1_DESC_ACTUAL_SIZE(gpt_config.p) - 1UL)) + 1UL;
+
+	if (end_pa < desc_end) {
+		cnt = (unsigned int)((end_pa - cur_pa) >> gpt_config.p);
+		*next_pa = end_pa;
+	} else {
+		cnt = GPT_L1_GPI_IDX_MASK + 1U - first;
+		*next_pa = desc_end;
+	}
+
+	assert((cnt != 0U) && ((first + cnt) <= (GPT_L1_GPI_IDX_MASK + 1U)));
+
+	if (cnt == (GPT_L1_GPI_IDX_MASK + 1U)) {
+		return ~0UL;
+	}
+
+	return ((1UL << (cnt << 2)) - 1UL) << (first << 2);
+}
+
+/*
+ * Helper to get the GPI fields of an L1 descriptor laid out as in a granules
+ * descriptor, whether the descriptor is a granules or a contiguous descriptor.
+ */
+static inline uint64_t gpt_l1_desc_gpis(uint64_t desc)
+{
+	if (GPT_L1_IS_CONT_DESC(desc)) {
+		return GPT_BUILD_L1_DESC(GPT_L1_CONT_GPI(desc));
+	}
+
+	return desc;
+}
+
+/*
+ * This function walks the L1 descriptors of a range of granules and checks
+ * that every granule in the range currently has the GPI expected by the
+ * transition. Up to 16 GPIs are compared with a single masked comparison of
+ * the L1 descriptor.
+ *
+ * Parameters
+ *   base		Base address of the range, must be granule-aligned.
+ *   size		Size of the range, must be granule-aligned.
+ *   gpi		Expected GPI of every granule in the range.
+ *
+ * Return
+ *   -EINVAL if part of the range is not mapped at granule level, -EPERM if a
+ *   granule is in an unexpected state, 0 for success.
+ */
+static int gpt_check_range_gpi(uint64_t base, size_t size, unsigned int gpi)
+{
+	uint64_t gpi_field = GPT_BUILD_L1_DESC(gpi);
+	uint64_t end_pa = base + size;
+	uint64_t cur_pa = base;
+	uint64_t next_pa;
+	uint64_t gpi_mask;
+	uint64_t *l1;
+#if RME_GPT_LAZY_L1
+	uint64_t l0_desc;
+#endif
+
+	while (cur_pa < end_pa) {
+#if RME_GPT_LAZY_L1
+		/* An L0 region without L1 table yet has a single GPI. */
+		l0_desc = ((uint64_t *)gpt_config.plat_gpt_l0_base)[GPT_L0_IDX(cur_pa)];
+		if (gpt_is_l0_lazy(GPT_L0_IDX(cur_pa), l0_desc)) {
+			if (GPT_L0_BLKD_GPI(l0_desc) != gpi) {
+				return -EPERM;
+			}
+			cur_pa = gpt_get_l1_end_pa(cur_pa, end_pa);
+			continue;
+		}
+#endif
+
+		l1 = gpt_get_l1_tbl(cur_pa);
+		if (l1 == NULL) {
+			return -EINVAL;
+		}
+
+		/* Check every L1 descriptor within this L0 region. */
+		do {
+			gpi_mask = gpt_get_l1_gpi_mask(cur_pa, end_pa, &next_pa);
+			if ((gpt_l1_desc_gpis(l1[GPT_L1_IDX(gpt_config.p, cur_pa)]) &
+			     gpi_mask) != (gpi_field & gpi_mask)) {
+				VERBOSE("[GPT] Granule range 0x%" PRIx64
+					" - 0x%" PRIx64 " not in GPI 0x%x\n",
+					cur_pa, next_pa, gpi);
+				return -EPERM;
+			}
+			cur_pa = next_pa;
+		} while ((cur_pa < end_pa) && !GPT_IS_L0_ALIGNED(cur_pa));
+	}
+
+	return 0;
+}
+
+/*
+ * This function walks the L1 descriptors of a range of granules and sets the
+ * GPI of every granule in the range. Each L1 descriptor is updated with a
+ * single store, regardless of how many of its granules are transitioned. The
+ * range must have been checked with gpt_check_range_gpi() beforehand.
+ *
+ * Parameters
+ *   base		Base address of the range, must be granule-aligned.
+ *   size		Size of the range, must be granule-aligned.
+ *   gpi		GPI to set.
+ */
+static void gpt_write_range_gpi(uint64_t base, size_t size, unsigned int gpi)
+{
+	uint64_t gpi_field = GPT_BUILD_L1_DESC(gpi);
+	uint64_t end_pa = base + size;
+	uint64_t cur_pa = base;
+	uint64_t next_pa;
+	uint64_t gpi_mask;
+	unsigned int idx;
+	uint64_t *l1;
+
+	while (cur_pa < end_pa) {
+		l1 = gpt_get_l1_tbl(cur_pa);
+		assert(l1 != NULL);
+
+		do {
+			gpi_mask = gpt_get_l1_gpi_mask(cur_pa, end_pa, &next_pa);
+			idx = GPT_L1_IDX(gpt_config.p, cur_pa);
+			assert(!GPT_L1_IS_CONT_DESC(l1[idx]));
+			l1[idx] = (l1[idx] & ~gpi_mask) | (gpi_field & gpi_mask);
+			cur_pa = next_pa;
+		} while ((cur_pa < end_pa) && !GPT_IS_L0_ALIGNED(cur_pa));
+	}
+}
+
+/*
+ * Helper to validate the base and size of a granule transition request.
+ *
+ * Return
+ *   -EINVAL if the range is invalid, 0 otherwise.
+ */
+static int gpt_check_transition_range(uint64_t base, size_t size)
+{
+	/* Check that base and size are valid */
+	if ((ULONG_MAX - base) < size) {
+		VERBOSE("[GPT] Transition request address overflow!\n");
 		VERBOSE("      Base=0x%" PRIx64 "\n", base);
+		VERBOSE("      Size=0x%lx\n", size);
 		return -EINVAL;
 	}
 
-	/* Get the table index and GPI shift from PA. */
-	gpi_info->gpt_l1_addr = GPT_L0_TBLD_ADDR(gpt_l0_desc);
-	gpi_info->idx = GPT_L1_IDX(gpt_config.p, base);
-	gpi_info->gpi_shift = GPT_L1_GPI_IDX(gpt_config.p, base) << 2;
+	/* Make sure base and size are valid. */
+	if (((base & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
+	    ((size & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
+	    (size == 0UL) ||
+	    ((base + size) >= GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
+		VERBOSE("[GPT] Invalid granule transition address range!\n");
+		VERBOSE("      Base=0x%" PRIx64 "\n", base);
+		VERBOSE("      Size=0x%lx\n", size);
+		return -EINVAL;
+	}
 
-	gpi_info->gpt_l1_desc = (gpi_info->gpt_l1_addr)[gpi_info->idx];
-	gpi_info->gpi = (gpi_info->gpt_l1_desc >> gpi_info->gpi_shift) &
-		GPT_L1_GRAN_DESC_GPI_MASK;
 	return 0;
 }
 
@@ -1005,7 +2036,10 @@ static int get_gpi_params(uint64_t base, gpi_info_t *gpi_info)
  * transition request occurs it is routed to this function to have the request,
  * if valid, fulfilled following A1.1.1 Delegate of RME supplement
  *
- * TODO: implement support for transitioning multiple granules at once.
+ * A range of granules is transitioned at once: the whole range is checked
+ * first, so that either every granule is transitioned or none of them is. The
+ * cache maintenance to the PoPA and the TLB invalidation are issued once for
+ * the whole range.
  *
  * Parameters
  *   base		Base address of the region to transition, must be
@@ -1019,7 +2053,8 @@ static int get_gpi_params(uint64_t base, gpi_info_t *gpi_info)
  */
 int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 {
-	gpi_info_t gpi_info;
+	uint64_t lock_mask;
+	unsigned int waits;
 	uint64_t nse;
 	int res;
 	unsigned int target_pas;
@@ -1034,28 +2069,9 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	assert(src_sec_state == SMC_FROM_REALM ||
 	       src_sec_state == SMC_FROM_SECURE);
 
-	/* See if this is a single or a range of granule transition. */
-	if (size != GPT_PGS_ACTUAL_SIZE(gpt_config.p)) {
-		return -EINVAL;
-	}
-
-	/* Check that base and size are valid */
-	if ((ULONG_MAX - base) < size) {
-		VERBOSE("[GPT] Transition request address overflow!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
-	}
-
-	/* Make sure base and size are valid. */
-	if (((base & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    ((size & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    (size == 0UL) ||
-	    ((base + size) >= GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
-		VERBOSE("[GPT] Invalid granule transition address range!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
+	res = gpt_check_transition_range(base, size);
+	if (res != 0) {
+		return res;
 	}
 
 	target_pas = GPT_GPI_REALM;
@@ -1064,25 +2080,37 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	}
 
 	/*
-	 * Access to L1 tables is controlled by a global lock to ensure
-	 * that no more than one CPU is allowed to make changes at any
-	 * given time.
+	 * Access to the L1 descriptors of the range is controlled by the
+	 * locks covering it, to ensure that no more than one CPU is allowed
+	 * to make changes to them at any given time.
 	 */
-	spin_lock(&gpt_lock);
-	res = get_gpi_params(base, &gpi_info);
+	waits = gpt_lock_range(base, size, &lock_mask);
+
+	/* Check that the whole range is in NS state */
+	res = gpt_check_range_gpi(base, size, GPT_GPI_NS);
 	if (res != 0) {
-		spin_unlock(&gpt_lock);
+		VERBOSE("[GPT] Only Granule in NS state can be delegated.\n");
+		VERBOSE("      Caller: %u, Base: 0x%" PRIx64 ", Size: 0x%lx\n",
+			src_sec_state, base, size);
+		gpt_unlock(lock_mask);
+		gpt_report_lock_waits(waits);
 		return res;
 	}
 
-	/* Check that the current address is in NS state */
-	if (gpi_info.gpi != GPT_GPI_NS) {
-		VERBOSE("[GPT] Only Granule in NS state can be delegated.\n");
-		VERBOSE("      Caller: %u, Current GPI: %u\n", src_sec_state,
-			gpi_info.gpi);
-		spin_unlock(&gpt_lock);
-		return -EPERM;
+#if RME_GPT_LAZY_L1
+	/* Give an L1 table to the L0 regions of the range that have none. */
+	res = gpt_alloc_range_l1_tbls(base, size);
+	if (res != 0) {
+		gpt_unlock(lock_mask);
+		gpt_report_lock_waits(waits);
+		return res;
 	}
+#endif
+
+#if GPT_L1_CONTIG_MAX != 0
+	/* Split any contiguous block so that granules can be updated. */
+	gpt_shatter_range(base, size);
+#endif
 
 	if (src_sec_state == SMC_FROM_SECURE) {
 		nse = (uint64_t)GPT_NSE_SECURE << GPT_NSE_SHIFT;
@@ -1095,30 +2123,35 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	 * states, remove any data speculatively fetched into the target
 	 * physical address space. Issue DC CIPAPA over address range
 	 */
-	flush_dcache_to_popa_range(nse | base,
-				   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	flush_dcache_to_popa_range(nse | base, size);
 
-	write_gpt(&gpi_info.gpt_l1_desc, gpi_info.gpt_l1_addr,
-		  gpi_info.gpi_shift, gpi_info.idx, target_pas);
+	gpt_write_range_gpi(base, size, target_pas);
 	dsboshst();
 
-	gpt_tlbi_by_pa_ll(base, GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	gpt_tlbi_by_pa_ll(base, size);
 	dsbosh();
 
 	nse = (uint64_t)GPT_NSE_NS << GPT_NSE_SHIFT;
 
-	flush_dcache_to_popa_range(nse | base,
-				   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	flush_dcache_to_popa_range(nse | base, size);
+
+#if GPT_L1_CONTIG_MAX != 0
+	/* Describe the range with contiguous descriptors where possible. */
+	waits += gpt_fuse_range(base, size, &lock_mask);
+#endif
 
 	/* Unlock access to the L1 tables. */
-	spin_unlock(&gpt_lock);
+	gpt_unlock(lock_mask);
+	gpt_report_lock_waits(waits);
 
 	/*
 	 * The isb() will be done as part of context
 	 * synchronization when returning to lower EL
 	 */
-	VERBOSE("[GPT] Granule 0x%" PRIx64 ", GPI 0x%x->0x%x\n",
-		base, gpi_info.gpi, target_pas);
+	VERBOSE("[GPT] Granules 0x%" PRIx64 " - 0x%" PRIx64 ", GPI 0x%x->0x%x\n",
+		base, base + size - 1UL, GPT_GPI_NS, target_pas);
+
+	EL3_TRACE(EL3_TRACE_GPT_DELEGATE, base, size, target_pas);
 
 	return 0;
 }
@@ -1128,7 +2161,8 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
  * transition request occurs it is routed to this function where the request is
  * validated then fulfilled if possible.
  *
- * TODO: implement support for transitioning multiple granules at once.
+ * As for delegation, a range of granules is transitioned at once and the
+ * request either succeeds for the whole range or leaves it untouched.
  *
  * Parameters
  *   base		Base address of the region to transition, must be
@@ -1142,9 +2176,11 @@ int gpt_delegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
  */
 int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 {
-	gpi_info_t gpi_info;
+	uint64_t lock_mask;
+	unsigned int waits;
 	uint64_t nse;
 	int res;
+	unsigned int src_pas;
 
 	/* Ensure that the tables have been set up before taking requests. */
 	assert(gpt_config.plat_gpt_l0_base != 0UL);
@@ -1156,66 +2192,58 @@ int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	assert(src_sec_state == SMC_FROM_REALM ||
 	       src_sec_state == SMC_FROM_SECURE);
 
-	/* See if this is a single or a range of granule transition. */
-	if (size != GPT_PGS_ACTUAL_SIZE(gpt_config.p)) {
-		return -EINVAL;
-	}
-
-	/* Check that base and size are valid */
-	if ((ULONG_MAX - base) < size) {
-		VERBOSE("[GPT] Transition request address overflow!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
+	res = gpt_check_transition_range(base, size);
+	if (res != 0) {
+		return res;
 	}
 
-	/* Make sure base and size are valid. */
-	if (((base & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    ((size & (GPT_PGS_ACTUAL_SIZE(gpt_config.p) - 1)) != 0UL) ||
-	    (size == 0UL) ||
-	    ((base + size) >= GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
-		VERBOSE("[GPT] Invalid granule transition address range!\n");
-		VERBOSE("      Base=0x%" PRIx64 "\n", base);
-		VERBOSE("      Size=0x%lx\n", size);
-		return -EINVAL;
+	src_pas = GPT_GPI_REALM;
+	if (src_sec_state == SMC_FROM_SECURE) {
+		src_pas = GPT_GPI_SECURE;
 	}
 
 	/*
-	 * Access to L1 tables is controlled by a global lock to ensure
-	 * that no more than one CPU is allowed to make changes at any
-	 * given time.
+	 * Access to the L1 descriptors of the range is controlled by the
+	 * locks covering it, to ensure that no more than one CPU is allowed
+	 * to make changes to them at any given time.
 	 */
-	spin_lock(&gpt_lock);
+	waits = gpt_lock_range(base, size, &lock_mask);
 
-	res = get_gpi_params(base, &gpi_info);
+	/* Check that the whole range is in the delegated state */
+	res = gpt_check_range_gpi(base, size, src_pas);
 	if (res != 0) {
-		spin_unlock(&gpt_lock);
+		VERBOSE("[GPT] Only Granule in REALM or SECURE state can be undelegated.\n");
+		VERBOSE("      Caller: %u, Base: 0x%" PRIx64 ", Size: 0x%lx\n",
+			src_sec_state, base, size);
+		gpt_unlock(lock_mask);
+		gpt_report_lock_waits(waits);
 		return res;
 	}
 
-	/* Check that the current address is in the delegated state */
-	if ((src_sec_state == SMC_FROM_REALM  &&
-	     gpi_info.gpi != GPT_GPI_REALM) ||
-	    (src_sec_state == SMC_FROM_SECURE &&
-	     gpi_info.gpi != GPT_GPI_SECURE)) {
-		VERBOSE("[GPT] Only Granule in REALM or SECURE state can be undelegated.\n");
-		VERBOSE("      Caller: %u, Current GPI: %u\n", src_sec_state,
-			gpi_info.gpi);
-		spin_unlock(&gpt_lock);
-		return -EPERM;
+#if RME_GPT_LAZY_L1
+	/* Give an L1 table to the L0 regions of the range that have none. */
+	res = gpt_alloc_range_l1_tbls(base, size);
+	if (res != 0) {
+		gpt_unlock(lock_mask);
+		gpt_report_lock_waits(waits);
+		return res;
 	}
+#endif
 
+#if GPT_L1_CONTIG_MAX != 0
+	/* Split any contiguous block so that granules can be updated. */
+	gpt_shatter_range(base, size);
+#endif
 
 	/* In order to maintain mutual distrust between Realm and Secure
 	 * states, remove access now, in order to guarantee that writes
 	 * to the currently-accessible physical address space will not
 	 * later become observable.
 	 */
-	write_gpt(&gpi_info.gpt_l1_desc, gpi_info.gpt_l1_addr,
-		  gpi_info.gpi_shift, gpi_info.idx, GPT_GPI_NO_ACCESS);
+	gpt_write_range_gpi(base, size, GPT_GPI_NO_ACCESS);
 	dsboshst();
 
-	gpt_tlbi_by_pa_ll(base, GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	gpt_tlbi_by_pa_ll(base, size);
 	dsbosh();
 
 	if (src_sec_state == SMC_FROM_SECURE) {
@@ -1225,8 +2253,7 @@ int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	}
 
 	/* Ensure that the scrubbed data has made it past the PoPA */
-	flush_dcache_to_popa_range(nse | base,
-				   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	flush_dcache_to_popa_range(nse | base, size);
 
 	/*
 	 * Remove any data loaded speculatively
@@ -1234,27 +2261,227 @@ int gpt_undelegate_pas(uint64_t base, size_t size, unsigned int src_sec_state)
 	 */
 	nse = (uint64_t)GPT_NSE_NS << GPT_NSE_SHIFT;
 
-	flush_dcache_to_popa_range(nse | base,
-				   GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	flush_dcache_to_popa_range(nse | base, size);
 
 	/* Clear existing GPI encoding and transition granule. */
-	write_gpt(&gpi_info.gpt_l1_desc, gpi_info.gpt_l1_addr,
-		  gpi_info.gpi_shift, gpi_info.idx, GPT_GPI_NS);
+	gpt_write_range_gpi(base, size, GPT_GPI_NS);
 	dsboshst();
 
 	/* Ensure that all agents observe the new NS configuration */
-	gpt_tlbi_by_pa_ll(base, GPT_PGS_ACTUAL_SIZE(gpt_config.p));
+	gpt_tlbi_by_pa_ll(base, size);
 	dsbosh();
 
+#if GPT_L1_CONTIG_MAX != 0
+	/* Describe the range with contiguous descriptors where possible. */
+	waits += gpt_fuse_range(base, size, &lock_mask);
+#endif
+
 	/* Unlock access to the L1 tables. */
-	spin_unlock(&gpt_lock);
+	gpt_unlock(lock_mask);
+	gpt_report_lock_waits(waits);
 
 	/*
 	 * The isb() will be done as part of context
 	 * synchronization when returning to lower EL
 	 */
-	VERBOSE("[GPT] Granule 0x%" PRIx64 ", GPI 0x%x->0x%x\n",
-		base, gpi_info.gpi, GPT_GPI_NS);
+	VERBOSE("[GPT] Granules 0x%" PRIx64 " - 0x%" PRIx64 ", GPI 0x%x->0x%x\n",
+		base, base + size - 1UL, src_pas, GPT_GPI_NS);
+
+	EL3_TRACE(EL3_TRACE_GPT_UNDELEGATE, base, size, src_pas);
 
 	return 0;
 }
+
+/*
+ * Helper to get the GPI fields of the 16 granules described by the L1
+ * descriptor covering a physical address, laid out as in a granules
+ * descriptor. Granules of an L0 region described by a block descriptor all
+ * have the GPI of the block.
+ */
+static uint64_t gpt_get_desc_gpis(uint64_t pa)
+{
+	uint64_t l0_desc = ((uint64_t *)gpt_config.plat_gpt_l0_base)[GPT_L0_IDX(pa)];
+
+	if (GPT_L0_TYPE(l0_desc) != GPT_L0_TYPE_TBL_DESC) {
+		return GPT_BUILD_L1_DESC(GPT_L0_BLKD_GPI(l0_desc));
+	}
+
+	return gpt_l1_desc_gpis(GPT_L0_TBLD_ADDR(l0_desc)[GPT_L1_IDX(gpt_config.p,
+								     pa)]);
+}
+
+/*
+ * Public API to read the GPIs of a range of granules. The GPIs are packed 16
+ * per 64-bit word, using the layout of L1 granules descriptors: the GPI of the
+ * n-th granule of the range is in bits [4 * (n % 16) + 3 : 4 * (n % 16)] of
+ * word n / 16. The unused GPI fields of the last word are set to zero.
+ *
+ * The descriptors are read without taking the GPT locks, so a granule being
+ * transitioned concurrently can be reported in either of its states.
+ *
+ * Parameters
+ *   base		Base address of the range, must be aligned to granule
+ *			size.
+ *   cnt		Number of granules in the range.
+ *   *gpis		Buffer receiving the GPIs, of (cnt + 15) / 16 words.
+ *
+ * Return
+ *   Negative Linux error code in the event of a failure, 0 for success.
+ */
+int gpt_get_gpis(uint64_t base, size_t cnt, uint64_t *gpis)
+{
+	unsigned int shift;
+	uint64_t desc_size;
+	uint64_t pa;
+	size_t words;
+	size_t left;
+	int res;
+
+	/* Ensure that the tables have been set up before taking requests. */
+	assert(gpt_config.plat_gpt_l0_base != 0UL);
+	assert(gpis != NULL);
+
+	if ((cnt == 0UL) ||
+	    (cnt > (GPT_PPS_ACTUAL_SIZE(gpt_config.t) >> gpt_config.p))) {
+		return -EINVAL;
+	}
+
+	res = gpt_check_transition_range(base, cnt << gpt_config.p);
+	if (res != 0) {
+		return res;
+	}
+
+	/*
+	 * A word of the result straddles two L1 descriptors unless the range
+	 * starts on the first granule of a descriptor.
+	 */
+	shift = GPT_L1_GPI_IDX(gpt_config.p, base) << 2;
+	desc_size = GPT_L1_DESC_ACTUAL_SIZE(gpt_config.p);
+	words = (cnt + GPT_L1_GPI_IDX_MASK) >> 4;
+	pa = base;
+
+	for (size_t i = 0UL; i < words; i++) {
+		gpis[i] = gpt_get_desc_gpis(pa) >> shift;
+		left = cnt - (i << 4);
+
+		if ((shift != 0U) &&
+		    (left > ((64U - shift) >> 2))) {
+			gpis[i] |= gpt_get_desc_gpis(pa + desc_size) <<
+				   (64U - shift);
+		}
+
+		/* Clear the GPI fields past the end of the range. */
+		if (left < (GPT_L1_GPI_IDX_MASK + 1U)) {
+			gpis[i] &= (1UL << (left << 2)) - 1UL;
+		}
+
+		pa += desc_size;
+	}
+
+	return 0;
+}
+
+/*
+ * Public API to check that a range of memory only contains granules of a given
+ * PAS. The range does not need to be aligned to the granule size, every granule
+ * it overlaps is checked. As with gpt_get_gpis(), the descriptors are read
+ * without taking the GPT locks, use gpt_lock_pas() to keep the range in the PAS
+ * while accessing it.
+ *
+ * Parameters
+ *   base		Base address of the range.
+ *   size		Size of the range in bytes.
+ *   gpi		Expected GPI of every granule of the range.
+ *
+ * Return
+ *   -EPERM if a granule has a different GPI, another negative Linux error code
+ *   if the range is invalid, 0 for success.
+ */
+int gpt_check_pas(uint64_t base, size_t size, unsigned int gpi)
+{
+	uint64_t granule = GPT_PGS_ACTUAL_SIZE(gpt_config.p);
+	uint64_t pa;
+	uint64_t end;
+	unsigned int shift;
+
+	/* Ensure that the tables have been set up before taking requests. */
+	assert(gpt_config.plat_gpt_l0_base != 0UL);
+
+	if ((size == 0UL) || ((ULONG_MAX - base) < size) ||
+	    ((base + size) > GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
+		return -EINVAL;
+	}
+
+	end = round_up(base + size, granule);
+	for (pa = round_down(base, granule); pa < end; pa += granule) {
+		shift = GPT_L1_GPI_IDX(gpt_config.p, pa) << 2;
+		if (((gpt_get_desc_gpis(pa) >> shift) &
+		     GPT_L1_GRAN_DESC_GPI_MASK) != gpi) {
+			return -EPERM;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Public API to check that a range of memory only contains granules of a given
+ * PAS, and to keep it in that PAS until gpt_unlock_pas() is called. The GPT
+ * locks covering the range are held in the meantime, so no granule of the
+ * range can be transitioned, and the caller must not request a transition
+ * itself.
+ *
+ * Parameters
+ *   base		Base address of the range.
+ *   size		Size of the range in bytes.
+ *   gpi		Expected GPI of every granule of the range.
+ *   *lock_mask		Set to the mask of the locks held on success.
+ *
+ * Return
+ *   -EPERM if a granule has a different GPI, another negative Linux error code
+ *   if the range is invalid, 0 for success.
+ */
+int gpt_lock_pas(uint64_t base, size_t size, unsigned int gpi,
+		 uint64_t *lock_mask)
+{
+	uint64_t mask;
+	unsigned int waits;
+	int res;
+
+	/* Ensure that the tables have been set up before taking requests. */
+	assert(gpt_config.plat_gpt_l0_base != 0UL);
+
+	if ((size == 0UL) || ((ULONG_MAX - base) < size) ||
+	    ((base + size) > GPT_PPS_ACTUAL_SIZE(gpt_config.t))) {
+		return -EINVAL;
+	}
+
+	/*
+	 * Splitting or fusing a block takes the locks of the whole block, so
+	 * the locks of the range are enough to keep its descriptors stable.
+	 */
+	mask = gpt_get_lock_mask(base, size);
+	waits = gpt_lock(mask);
+
+	res = gpt_check_pas(base, size, gpi);
+	if (res != 0) {
+		gpt_unlock(mask);
+	} else {
+		*lock_mask = mask;
+	}
+
+	gpt_report_lock_waits(waits);
+
+	return res;
+}
+
+/*
+ * Public API to release a range of memory kept in its PAS by gpt_lock_pas().
+ *
+ * Parameters
+ *   lock_mask		Mask of the locks returned by gpt_lock_pas().
+ */
+void gpt_unlock_pas(uint64_t lock_mask)
+{
+	gpt_unlock(lock_mask);
+}
@@ -19,7 +19,7 @@
 #define GPT_L0_TYPE_MASK		UL(0xF)
 #define GPT_L0_TYPE_SHIFT		U(0)
 
-/* For now, we don't support contiguous descriptors, only table and block. */
+/* L0 descriptors are either table or block descriptors. */
 #define GPT_L0_TYPE_TBL_DESC		UL(0x3)
 #define GPT_L0_TYPE_BLK_DESC		UL(0x1)
 
@@ -32,6 +32,25 @@
 /* GPT level 1 descriptor bit definitions */
 #define GPT_L1_GRAN_DESC_GPI_MASK	UL(0xF)
 
+/*
+ * GPT level 1 contiguous descriptor bit definitions. A contiguous descriptor
+ * is told apart from a granules descriptor by its bits [3:0], which would
+ * otherwise hold the reserved GPI value 0b0001.
+ */
+#define GPT_L1_TYPE_CONT_DESC_MASK	UL(0xF)
+#define GPT_L1_TYPE_CONT_DESC		UL(0x1)
+
+#define GPT_L1_CONT_DESC_GPI_MASK	UL(0xF)
+#define GPT_L1_CONT_DESC_GPI_SHIFT	U(4)
+
+#define GPT_L1_CONT_DESC_CONTIG_MASK	UL(0x3)
+#define GPT_L1_CONT_DESC_CONTIG_SHIFT	U(8)
+
+/* Encodings of the Contig field of a contiguous descriptor. */
+#define GPT_L1_CONTIG_2MB		U(1)
+#define GPT_L1_CONTIG_32MB		U(2)
+#define GPT_L1_CONTIG_512MB		U(3)
+
 /*
  * This macro fills out every GPI entry in a granules descriptor to the same
  * value.
@@ -53,6 +72,69 @@
 					 ((uint64_t)(_gpi) << 4*14) | \
 					 ((uint64_t)(_gpi) << 4*15))
 
+/*
+ * Largest Contig value used by the library, as selected by the
+ * RME_GPT_MAX_BLOCK build option. Zero means that contiguous descriptors are
+ * not used.
+ */
+#if RME_GPT_MAX_BLOCK == 0
+#define GPT_L1_CONTIG_MAX		U(0)
+#elif RME_GPT_MAX_BLOCK == 2
+#define GPT_L1_CONTIG_MAX		GPT_L1_CONTIG_2MB
+#elif RME_GPT_MAX_BLOCK == 32
+#define GPT_L1_CONTIG_MAX		GPT_L1_CONTIG_32MB
+#elif RME_GPT_MAX_BLOCK == 512
+#define GPT_L1_CONTIG_MAX		GPT_L1_CONTIG_512MB
+#else
+#error "Invalid value for RME_GPT_MAX_BLOCK"
+#endif
+
+/******************************************************************************/
+/* GPT locking                                                                */
+/******************************************************************************/
+
+/*
+ * The L1 descriptors are protected by an array of locks, one bit per lock in a
+ * 64-bit lock mask. The protected space is split in blocks of
+ * (1 << GPT_LOCK_BLOCK_SHIFT) bytes and each block is assigned to the lock at
+ * (block index % GPT_LOCK_COUNT), so transitions on unrelated PA ranges take
+ * different locks. A block must cover whole L1 descriptors, which describe at
+ * most 1MB of memory with 64KB granules.
+ */
+#define GPT_LOCK_COUNT			U(64)
+#define GPT_LOCK_BLOCK_SHIFT		U(21)
+
+/******************************************************************************/
+/* On-demand L1 tables                                                        */
+/******************************************************************************/
+
+#if RME_GPT_LAZY_L1
+/* L1 memory left unused by the first call to gpt_init_pas_l1_tables(). */
+typedef struct {
+	uintptr_t base;			/* Base address of the range */
+	unsigned int cnt;		/* Number of L1 tables in the range */
+	unsigned int next;		/* Index of the next free L1 table */
+} gpt_l1_pool_range_t;
+
+/*
+ * Granule-mapped L0 regions entirely covered by a single PAS are described by
+ * an L0 block descriptor at boot, and only get an L1 table from a pool of free
+ * tables when one of their granules is first transitioned. This structure
+ * records those regions and the pool. Both are stored at the end of the L1
+ * memory supplied to the first call to gpt_init_pas_l1_tables(), where the
+ * runtime stage finds them with gpt_runtime_init_l1_pool().
+ */
+typedef struct {
+	gpt_l1_pool_range_t pool;	/* Free L1 tables */
+	uint64_t l0_lazy[];		/* Bitmap of the on-demand L0 regions */
+} gpt_lazy_l1_info_t;
+
+/* Size of the on-demand L1 table information for a given T value. */
+#define GPT_LAZY_L1_INFO_SIZE(_t)	(sizeof(gpt_lazy_l1_info_t) +	\
+					((((size_t)GPT_L0_REGION_COUNT(_t) +	\
+					63U) >> 6U) << 3U))
+#endif /* RME_GPT_LAZY_L1 */
+
 /******************************************************************************/
 /* GPT platform configuration                                                 */
 /******************************************************************************/
@@ -106,17 +188,6 @@ typedef enum {
 	PGS_64KB_P =	16U
 } gpt_p_val_e;
 
-/*
- * Internal structure to retrieve the values from get_gpi_info();
- */
-typedef struct gpi_info {
-	uint64_t gpt_l1_desc;
-	uint64_t *gpt_l1_addr;
-	unsigned int idx;
-	unsigned int gpi_shift;
-	unsigned int gpi;
-} gpi_info_t;
-
 /* Max valid value for PGS. */
 #define GPT_PGS_MAX			(2U)
 
@@ -211,6 +282,9 @@ typedef struct gpi_info {
 /* Granule actual size in bytes. */
 #define GPT_PGS_ACTUAL_SIZE(_p)	(1UL << (_p))
 
+/* Size in bytes of the memory described by a single L1 descriptor. */
+#define GPT_L1_DESC_ACTUAL_SIZE(_p)	(1UL << GPT_L1_IDX_SHIFT(_p))
+
 /* L0 GPT region size in bytes. */
 #define GPT_L0GPTSZ_ACTUAL_SIZE	(1UL << GPT_S_VAL)
 
@@ -254,6 +328,31 @@ typedef struct gpi_info {
 #define GPT_L1_GPI_IDX(_p, _pa)	(((_pa) >> GPT_L1_GPI_IDX_SHIFT(_p)) & \
 				GPT_L1_GPI_IDX_MASK)
 
+/* Create an L1 contiguous descriptor. */
+#define GPT_L1_CONT_DESC(_gpi, _contig)					\
+				(GPT_L1_TYPE_CONT_DESC |		\
+				(((uint64_t)(_gpi) & GPT_L1_CONT_DESC_GPI_MASK) << \
+				GPT_L1_CONT_DESC_GPI_SHIFT) |		\
+				(((uint64_t)(_contig) &			\
+				GPT_L1_CONT_DESC_CONTIG_MASK) <<	\
+				GPT_L1_CONT_DESC_CONTIG_SHIFT))
+
+/* Determine if an L1 descriptor is a contiguous descriptor. */
+#define GPT_L1_IS_CONT_DESC(_desc)	(((_desc) & GPT_L1_TYPE_CONT_DESC_MASK) \
+					== GPT_L1_TYPE_CONT_DESC)
+
+/* Get the GPI from an L1 contiguous descriptor. */
+#define GPT_L1_CONT_GPI(_desc)	(((_desc) >> GPT_L1_CONT_DESC_GPI_SHIFT) & \
+				GPT_L1_CONT_DESC_GPI_MASK)
+
+/* Get the Contig field from an L1 contiguous descriptor. */
+#define GPT_L1_CONT_CONTIG(_desc)	(((_desc) >>			\
+					GPT_L1_CONT_DESC_CONTIG_SHIFT) &	\
+					GPT_L1_CONT_DESC_CONTIG_MASK)
+
+/* Size in bytes of the block described by a given Contig value. */
+#define GPT_L1_CONT_SIZE(_contig)	(1UL << (17U + ((_contig) << 2)))
+
 /* Determine if an address is granule-aligned. */
 #define GPT_IS_L1_ALIGNED(_p, _pa) (((_pa) & (GPT_PGS_ACTUAL_SIZE(_p) - U(1))) \
 				   == U(0))
@@ -1,10 +1,11 @@
 /*
- * Copyright (c) 2016-2018, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include <common/debug.h>
 #include <lib/pmf/pmf.h>
@@ -56,6 +57,38 @@ uintptr_t pmf_smc_handler(unsigned int smc_fid,
 					(unsigned int)x3, &ts_value);
 			SMC_RET2(handle, rc, ts_value);
 		}
+
+#if ENABLE_SMC_LATENCY_HIST
+		if (smc_fid == PMF_SMC_GET_SMC_HIST_64) {
+			uint32_t hist_fid = 0U;
+			pmf_smc_hist_entry_t entry;
+			uint64_t b[3] = { 0U };
+			unsigned int i;
+
+			/*
+			 * x1 --> MPIDR of the CPU.
+			 * x2 --> index of the entry.
+			 * x3 --> first histogram bucket to return.
+			 *
+			 * Return error code and the entry to the caller.
+			 * x0 --> error code.
+			 * x1 --> SMC function ID.
+			 * x2 - x4 --> count, total and maximum latency.
+			 * x5 - x7 --> buckets x3 to x3 + 2.
+			 */
+			(void)memset(&entry, 0, sizeof(entry));
+			rc = pmf_smc_hist_get(x1, (unsigned int)x2, &hist_fid,
+					      &entry);
+			for (i = 0U; i < ARRAY_SIZE(b); i++) {
+				if (x3 < (PMF_SMC_HIST_BUCKETS - i)) {
+					b[i] = entry.hist[x3 + i];
+				}
+			}
+			SMC_RET8(handle, rc, hist_fid, entry.count,
+				 entry.total_ticks, entry.max_ticks,
+				 b[0], b[1], b[2]);
+		}
+#endif
 	}
 
 	WARN("Unimplemented PMF Call: 0x%x \n", smc_fid);
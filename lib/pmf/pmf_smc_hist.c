@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2023, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <arch_helpers.h>
+#include <lib/cassert.h>
+#include <lib/pmf/pmf.h>
+#include <lib/utils_def.h>
+#include <plat/common/platform.h>
+
+#include <platform_def.h>
+
+/*
+ * Number of function IDs tracked by each CPU. The last entry is shared by the
+ * function IDs seen once all the others are in use.
+ */
+#ifndef PLAT_PMF_SMC_HIST_FIDS
+#define PLAT_PMF_SMC_HIST_FIDS	U(16)
+#endif
+
+CASSERT(PLAT_PMF_SMC_HIST_FIDS > 1U, assert_pmf_smc_hist_fids_too_small);
+CASSERT((sizeof(pmf_smc_hist_entry_t) % CACHE_WRITEBACK_GRANULE) == 0U,
+	assert_pmf_smc_hist_entry_not_cache_aligned);
+
+/*
+ * Histograms of a CPU. Only that CPU updates them, from the SMC exit path, so
+ * no locking is needed. The function IDs are kept apart from the histograms
+ * so that looking one up only touches a couple of cache lines.
+ */
+typedef struct pmf_smc_hist_cpu {
+	unsigned int nr_fids;
+	uint32_t fids[PLAT_PMF_SMC_HIST_FIDS];
+	pmf_smc_hist_entry_t entries[PLAT_PMF_SMC_HIST_FIDS]
+		__aligned(CACHE_WRITEBACK_GRANULE);
+} pmf_smc_hist_cpu_t;
+
+static pmf_smc_hist_cpu_t pmf_smc_hist[PLATFORM_CORE_COUNT]
+	__aligned(CACHE_WRITEBACK_GRANULE);
+
+/*
+ * Return the index of the entry tracking 'smc_fid', claiming a new one the
+ * first time the function ID is seen.
+ */
+static unsigned int pmf_smc_hist_find(pmf_smc_hist_cpu_t *cpu,
+				      uint32_t smc_fid)
+{
+	unsigned int i;
+
+	for (i = 0U; i < cpu->nr_fids; i++) {
+		if (cpu->fids[i] == smc_fid) {
+			return i;
+		}
+	}
+
+	if (cpu->nr_fids < (PLAT_PMF_SMC_HIST_FIDS - 1U)) {
+		cpu->fids[i] = smc_fid;
+		cpu->nr_fids++;
+		return i;
+	}
+
+	/* Table full, account for the SMC in the last entry */
+	return PLAT_PMF_SMC_HIST_FIDS - 1U;
+}
+
+/*
+ * Account for an SMC handled by this CPU. It is called by the SMC exit path
+ * with the system counter value sampled when the SMC was taken, so the latency
+ * covers the whole of the SMC handling in EL3.
+ */
+void pmf_smc_hist_record(uint32_t smc_fid, uint64_t start_ticks)
+{
+	pmf_smc_hist_cpu_t *cpu = &pmf_smc_hist[plat_my_core_pos()];
+	pmf_smc_hist_entry_t *entry;
+	uint64_t ticks = read_cntpct_el0() - start_ticks;
+	unsigned int bucket;
+
+	entry = &cpu->entries[pmf_smc_hist_find(cpu, smc_fid)];
+
+	bucket = 63U - (unsigned int)__builtin_clzll(ticks | 1ULL);
+	if (bucket >= PMF_SMC_HIST_BUCKETS) {
+		bucket = PMF_SMC_HIST_BUCKETS - 1U;
+	}
+
+	entry->count++;
+	entry->total_ticks += ticks;
+	if (ticks > entry->max_ticks) {
+		entry->max_ticks = ticks;
+	}
+	entry->hist[bucket]++;
+}
+
+/*
+ * Copy entry 'index' of the histograms of the CPU identified by 'mpidr'. The
+ * entries in use are numbered from 0, so -ENOENT marks the end of the table.
+ * The CPU may update the entry meanwhile, in which case the copy may mix
+ * values from before and after the update.
+ */
+int pmf_smc_hist_get(u_register_t mpidr,
+		unsigned int index,
+		uint32_t *smc_fid,
+		pmf_smc_hist_entry_t *entry)
+{
+	const pmf_smc_hist_cpu_t *cpu;
+	int core_pos;
+
+	assert((smc_fid != NULL) && (entry != NULL));
+
+	core_pos = plat_core_pos_by_mpidr(mpidr);
+	if (core_pos < 0) {
+		return -EINVAL;
+	}
+
+	cpu = &pmf_smc_hist[core_pos];
+	if (index < cpu->nr_fids) {
+		*smc_fid = cpu->fids[index];
+	} else if ((index == (PLAT_PMF_SMC_HIST_FIDS - 1U)) &&
+		   (cpu->entries[index].count != 0U)) {
+		*smc_fid = PMF_SMC_HIST_FID_OTHER;
+	} else {
+		return -ENOENT;
+	}
+
+	(void)memcpy(entry, &cpu->entries[index], sizeof(*entry));
+
+	return 0;
+}
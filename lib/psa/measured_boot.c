@@ -8,6 +8,9 @@
 #include <string.h>
 
 #include <common/debug.h>
+#ifdef IMAGE_BL31
+#include <lib/el3_runtime/pubsub_events.h>
+#endif
 #include <measured_boot.h>
 #include <psa/client.h>
 #include <psa_manifest/sid.h>
@@ -84,6 +87,7 @@ rss_measured_boot_extend_measurement(uint8_t index,
 		.sw_type_size = (sw_type_size > 0) ? (sw_type_size - 1) : 0,
 	};
 
+	psa_status_t status;
 	psa_invec in_vec[] = {
 		{.base = &extend_iov,
 			.len = sizeof(struct measured_boot_extend_iovec_t)},
@@ -105,10 +109,18 @@ rss_measured_boot_extend_measurement(uint8_t index,
 			measurement_algo, measurement_value,
 			measurement_value_size, lock_measurement);
 
-	return psa_call(RSS_MEASURED_BOOT_HANDLE,
-			RSS_MEASURED_BOOT_EXTEND,
-			in_vec, IOVEC_LEN(in_vec),
-			NULL, 0);
+	status = psa_call(RSS_MEASURED_BOOT_HANDLE,
+			  RSS_MEASURED_BOOT_EXTEND,
+			  in_vec, IOVEC_LEN(in_vec),
+			  NULL, 0);
+
+#ifdef IMAGE_BL31
+	if (status == PSA_SUCCESS) {
+		PUBLISH_EVENT(measurement_extended);
+	}
+#endif
+
+	return status;
 }
 
 psa_status_t rss_measured_boot_read_measurement(uint8_t index,
@@ -186,6 +198,10 @@ rss_measured_boot_extend_measurement(uint8_t index,
 			measurement_algo, measurement_value,
 			measurement_value_size, lock_measurement);
 
+#ifdef IMAGE_BL31
+	PUBLISH_EVENT(measurement_extended);
+#endif
+
 	return PSA_SUCCESS;
 }
 
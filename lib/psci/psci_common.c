@@ -14,6 +14,7 @@
 #include <context.h>
 #include <drivers/delay_timer.h>
 #include <lib/el3_runtime/context_mgmt.h>
+#include <lib/el3_trace.h>
 #include <lib/utils.h>
 #include <plat/common/platform.h>
 
@@ -1058,6 +1059,8 @@ void psci_warmboot_entrypoint(void)
 	 * in the reverse order to which they were acquired.
 	 */
 	psci_release_pwr_domain_locks(end_pwrlvl, parent_nodes);
+
+	EL3_TRACE(EL3_TRACE_PSCI_WAKEUP, end_pwrlvl, 0U, 0U);
 }
 
 /*******************************************************************************
@@ -10,6 +10,8 @@
 #include <arch.h>
 #include <arch_helpers.h>
 #include <common/debug.h>
+#include <lib/el3_runtime/context_mgmt.h>
+#include <lib/el3_trace.h>
 #include <lib/pmf/pmf.h>
 #include <lib/runtime_instr.h>
 #include <plat/common/platform.h>
@@ -53,6 +55,8 @@ int psci_do_cpu_off(unsigned int end_pwrlvl)
 	 */
 	assert(psci_plat_pm_ops->pwr_domain_off != NULL);
 
+	EL3_TRACE(EL3_TRACE_PSCI_CPU_OFF, end_pwrlvl, 0U, 0U);
+
 	/* Construct the psci_power_state for CPU_OFF */
 	psci_set_power_off_state(&state_info);
 
@@ -83,6 +87,11 @@ int psci_do_cpu_off(unsigned int end_pwrlvl)
 			goto exit;
 	}
 
+#if CTX_LAZY_FPREGS
+	/* Save the FP registers, which are lost when powering down */
+	cm_fpregs_lazy_flush();
+#endif
+
 	/*
 	 * This function is passed the requested state info and
 	 * it returns the negotiated state info for each power level upto
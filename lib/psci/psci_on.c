@@ -13,6 +13,7 @@
 #include <common/debug.h>
 #include <lib/el3_runtime/context_mgmt.h>
 #include <lib/el3_runtime/pubsub_events.h>
+#include <lib/el3_trace.h>
 #include <plat/common/platform.h>
 
 #include "psci_private.h"
@@ -76,6 +77,8 @@ int psci_cpu_on_start(u_register_t target_cpu,
 	assert((psci_plat_pm_ops->pwr_domain_on != NULL) &&
 	       (psci_plat_pm_ops->pwr_domain_on_finish != NULL));
 
+	EL3_TRACE(EL3_TRACE_PSCI_CPU_ON, target_cpu, ep->pc, 0U);
+
 	/* Protect against multiple CPUs trying to turn ON the same target CPU */
 	psci_spin_lock_cpu(target_idx);
 
@@ -9,6 +9,11 @@ ifeq (${USE_DEBUGFS}, 1)
              library and is incompatible with ALLOW_RO_XLAT_TABLES.")
 endif
 
+ifeq (${ENABLE_EL3_TRACE}, 1)
+    $(error "EL3 trace requires functionality from the dynamic translation \
+             library and is incompatible with ALLOW_RO_XLAT_TABLES.")
+endif
+
 ifeq (${ARCH},aarch32)
     ifeq (${RESET_TO_SP_MIN},1)
        $(error "RESET_TO_SP_MIN requires functionality from the dynamic \
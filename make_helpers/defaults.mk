@@ -68,6 +68,10 @@ CTX_INCLUDE_FPREGS		:= 0
 # world. It is not needed to use it in the Non-secure world.
 CTX_INCLUDE_PAUTH_REGS		:= 0
 
+# Switch the FP registers in cpu context lazily, on the first FP/SIMD access
+# from a lower EL, instead of at every world switch
+CTX_LAZY_FPREGS			:= 0
+
 # Include Nested virtualization control (Armv8.4-NV) registers in cpu context.
 # This must be set to 1 if architecture implements Nested Virtualization
 # Extension and platform wants to use this feature in the Secure world
@@ -93,6 +97,9 @@ DISABLE_MTPMU			:= 0
 # development platforms.
 DYN_DISABLE_AUTH		:= 0
 
+# Flag to record EL3 events in per-CPU trace rings
+ENABLE_EL3_TRACE		:= 0
+
 # Build option to enable MPAM for lower ELs
 ENABLE_MPAM_FOR_LOWER_ELS	:= 0
 
@@ -117,6 +124,9 @@ ENABLE_RME			:= 0
 # Flag to enable runtime instrumentation using PMF
 ENABLE_RUNTIME_INSTRUMENTATION	:= 0
 
+# Flag to enable per-SMC latency histograms using PMF
+ENABLE_SMC_LATENCY_HIST		:= 0
+
 # Flag to enable stack corruption protection
 ENABLE_STACK_PROTECTOR		:= 0
 
@@ -228,6 +238,10 @@ HASH_ALG			:= sha256
 # operations.
 HW_ASSISTED_COHERENCY		:= 0
 
+# Hash images while they are loaded, one chunk after the other, rather than
+# after loading them, when authenticating them.
+IMAGE_HASH_STREAMING		:= 0
+
 # Set the default algorithm for the generation of Trusted Board Boot keys
 KEY_ALG				:= rsa
 
@@ -236,6 +250,10 @@ ifeq ($(KEY_ALG),rsa)
 KEY_SIZE			:= 2048
 endif
 
+# List of images to link with the optimised AArch64 memcpy(), memmove() and
+# memcmp() instead of the smaller C versions of libc
+LIBC_ASM_MEMFUNCS		:=
+
 # Option to build TF with Measured Boot support
 MEASURED_BOOT			:= 0
 
@@ -267,6 +285,27 @@ RESET_TO_BL31			:= 0
 # By default, clear the input registers when RESET_TO_BL31 is enabled
 RESET_TO_BL31_WITH_PARAMS	:= 0
 
+# Describe granule-mapped GPT level 0 regions entirely covered by a single PAS
+# with block descriptors until one of their granules is transitioned
+RME_GPT_LAZY_L1			:= 0
+
+# Maximum size, in MB, of the contiguous blocks described by GPT level 1
+# contiguous descriptors (0 to disable them, 2, 32 or 512)
+RME_GPT_MAX_BLOCK		:= 2
+
+# Only switch the EL2 system registers that differ between the Non-secure and
+# Realm worlds when RMMD forwards an SMC
+RMMD_LAZY_EL2_CTX		:= 0
+
+# Number of platform attestation tokens cached by the RMM dispatcher
+RMMD_ATTEST_TOKEN_CACHE		:= 0
+
+# Let the Normal world submit a queue of RMI commands with a single SMC
+RMMD_RMI_QUEUE			:= 0
+
+# Dispatch the hottest Standard Service fast calls through a function ID table
+RT_SVC_FID_TABLE		:= 0
+
 # For Chain of Trust
 SAVE_KEYS			:= 0
 
@@ -301,12 +340,20 @@ SPD				:= none
 # Enable the Management Mode (MM)-based Secure Partition Manager implementation
 SPM_MM				:= 0
 
+# Return BUSY from MM_COMMUNICATE instead of waiting in EL3 when all the
+# execution contexts of the MM Secure Partition are busy
+SPM_MM_BUSY_RETURN		:= 0
+
 # Use the FF-A SPMC implementation in EL3.
 SPMC_AT_EL3			:= 0
 
 # Use SPM at S-EL2 as a default config for SPMD
 SPMD_SPM_AT_SEL2		:= 1
 
+# Only switch the EL2 system registers that differ between the Non-secure and
+# Secure worlds when SPMD switches to or from an SPMC at S-EL2
+SPMD_LAZY_EL2_CTX		:= 0
+
 # Flag to introduce an infinite loop in BL1 just before it exits into the next
 # image. This is meant to help debugging the post-BL2 phase.
 SPIN_ON_BL1_EXIT		:= 0
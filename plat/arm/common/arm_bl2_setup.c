@@ -132,8 +132,8 @@ void bl2_platform_setup(void)
 static void arm_bl2_plat_gpt_setup(void)
 {
 	/*
-	 * The GPT library might modify the gpt regions structure to optimize
-	 * the layout, so the array cannot be constant.
+	 * The GPT library sorts the PAS regions in place by base address, so
+	 * the array cannot be constant.
 	 */
 	pas_region_t pas_regions[] = {
 		ARM_PAS_KERNEL,
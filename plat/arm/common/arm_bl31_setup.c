@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2022, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -422,6 +422,13 @@ void __init arm_bl31_plat_arch_setup(void)
 		ERROR("gpt_runtime_init() failed!\n");
 		panic();
 	}
+#if RME_GPT_LAZY_L1
+	if (gpt_runtime_init_l1_pool(ARM_L1_GPT_ADDR_BASE,
+				     ARM_L1_GPT_SIZE) < 0) {
+		ERROR("gpt_runtime_init_l1_pool() failed!\n");
+		panic();
+	}
+#endif
 #endif /* ENABLE_RME */
 
 	arm_setup_romlib();
@@ -10,6 +10,7 @@
 #include <common/runtime_svc.h>
 #include <drivers/arm/ethosn.h>
 #include <lib/debugfs.h>
+#include <lib/el3_trace.h>
 #include <lib/pmf/pmf.h>
 #include <plat/arm/common/arm_sip_svc.h>
 #include <plat/arm/common/plat_arm.h>
@@ -81,6 +82,15 @@ static uintptr_t arm_sip_handler(unsigned int smc_fid,
 
 #endif /* USE_DEBUGFS */
 
+#if ENABLE_EL3_TRACE
+
+	if (is_el3_trace_fid(smc_fid)) {
+		return el3_trace_smc_handler(smc_fid, x1, x2, x3, x4, cookie,
+					     handle, flags);
+	}
+
+#endif /* ENABLE_EL3_TRACE */
+
 #if ARM_ETHOSN_NPU_DRIVER
 
 	if (is_ethosn_fid(smc_fid)) {
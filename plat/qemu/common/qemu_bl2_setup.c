@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2022, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2023, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -111,8 +111,8 @@ void bl2_platform_setup(void)
 static void qemu_bl2_plat_gpt_setup(void)
 {
 	/*
-	 * The GPT library might modify the gpt regions structure to optimize
-	 * the layout, so the array cannot be constant.
+	 * The GPT library sorts the PAS regions in place by base address, so
+	 * the array cannot be constant.
 	 */
 	pas_region_t pas_regions[] = {
 		QEMU_PAS1_GPI_ANY,
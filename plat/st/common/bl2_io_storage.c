@@ -69,6 +69,8 @@ static io_block_dev_spec_t mmc_block_dev_spec = {
 		.write = NULL,
 	},
 	.block_size = MMC_BLOCK_SIZE,
+	/* SDMMC2 reads blocks to any 4-byte aligned buffer */
+	.direct_align = sizeof(uint32_t),
 };
 
 static const io_dev_connector_t *mmc_dev_con;
@@ -42,6 +42,10 @@ void pncd_init_pnc_ep_state(struct entry_point_info *pnc_entry_point,
 	if (read_sctlr_el3() & SCTLR_EE_BIT) {
 		ep_attr |= EP_EE_BIG;
 	}
+#if CTX_LAZY_FPREGS
+	/* The FP registers are not saved around calls to the SP in this case */
+	ep_attr |= EP_FPREGS_LAZY;
+#endif
 	SET_PARAM_HEAD(pnc_entry_point, PARAM_EP, VERSION_1, ep_attr);
 
 	pnc_entry_point->pc = pc;
@@ -67,7 +71,7 @@ uint64_t pncd_synchronous_sp_entry(pnc_context_t *pnc_ctx)
 	/* Apply the Secure EL1 system register context and switch to it */
 	assert(cm_get_context(SECURE) == &pnc_ctx->cpu_ctx);
 	cm_el1_sysregs_context_restore(SECURE);
-#if CTX_INCLUDE_FPREGS
+#if CTX_INCLUDE_FPREGS && !CTX_LAZY_FPREGS
 	fpregs_context_restore(get_fpregs_ctx(cm_get_context(SECURE)));
 #endif
 	cm_set_next_eret_context(SECURE);
@@ -90,7 +94,7 @@ void pncd_synchronous_sp_exit(pnc_context_t *pnc_ctx, uint64_t ret)
 	/* Save the Secure EL1 system register context */
 	assert(cm_get_context(SECURE) == &pnc_ctx->cpu_ctx);
 	cm_el1_sysregs_context_save(SECURE);
-#if CTX_INCLUDE_FPREGS
+#if CTX_INCLUDE_FPREGS && !CTX_LAZY_FPREGS
 	fpregs_context_save(get_fpregs_ctx(cm_get_context(SECURE)));
 #endif
 
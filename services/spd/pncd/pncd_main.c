@@ -55,7 +55,7 @@ static void context_save(unsigned long security_state)
 	assert(sec_state_is_valid(security_state));
 
 	cm_el1_sysregs_context_save((uint32_t) security_state);
-#if CTX_INCLUDE_FPREGS
+#if CTX_INCLUDE_FPREGS && !CTX_LAZY_FPREGS
 	fpregs_context_save(get_fpregs_ctx(cm_get_context(security_state)));
 #endif
 }
@@ -72,7 +72,7 @@ static void *context_restore(unsigned long security_state)
 
 	/* Restore state */
 	cm_el1_sysregs_context_restore((uint32_t) security_state);
-#if CTX_INCLUDE_FPREGS
+#if CTX_INCLUDE_FPREGS && !CTX_LAZY_FPREGS
 	fpregs_context_restore(get_fpregs_ctx(cm_get_context(security_state)));
 #endif
 
@@ -116,10 +116,13 @@ static struct smc_args trusty_context_switch(uint32_t security_state, uint64_t r
 	 * To avoid the additional overhead in PSCI flow, skip FP context
 	 * saving/restoring in case of CPU suspend and resume, assuming that
 	 * when it's needed the PSCI caller has preserved FP context before
-	 * going here.
+	 * going here. With CTX_LAZY_FPREGS, FP context is only switched when
+	 * trapped.
 	 */
+#if !CTX_LAZY_FPREGS
 	if (r0 != SMC_FC_CPU_SUSPEND && r0 != SMC_FC_CPU_RESUME)
 		fpregs_context_save(get_fpregs_ctx(cm_get_context(security_state)));
+#endif
 	cm_el1_sysregs_context_save(security_state);
 
 	ctx->saved_security_state = security_state;
@@ -128,8 +131,10 @@ static struct smc_args trusty_context_switch(uint32_t security_state, uint64_t r
 	assert(ctx->saved_security_state == ((security_state == 0U) ? 1U : 0U));
 
 	cm_el1_sysregs_context_restore(security_state);
+#if !CTX_LAZY_FPREGS
 	if (r0 != SMC_FC_CPU_SUSPEND && r0 != SMC_FC_CPU_RESUME)
 		fpregs_context_restore(get_fpregs_ctx(cm_get_context(security_state)));
+#endif
 
 	cm_set_next_eret_context(security_state);
 
@@ -320,7 +325,9 @@ static int32_t trusty_init(void)
 	ep_info = bl31_plat_get_next_image_ep_info(SECURE);
 	assert(ep_info != NULL);
 
+#if !CTX_LAZY_FPREGS
 	fpregs_context_save(get_fpregs_ctx(cm_get_context(NON_SECURE)));
+#endif
 	cm_el1_sysregs_context_save(NON_SECURE);
 
 	cm_set_context(&ctx->cpu_ctx, SECURE);
@@ -337,7 +344,9 @@ static int32_t trusty_init(void)
 	}
 
 	cm_el1_sysregs_context_restore(SECURE);
+#if !CTX_LAZY_FPREGS
 	fpregs_context_restore(get_fpregs_ctx(cm_get_context(SECURE)));
+#endif
 	cm_set_next_eret_context(SECURE);
 
 	ctx->saved_security_state = ~0U; /* initial saved state is invalid */
@@ -346,7 +355,9 @@ static int32_t trusty_init(void)
 	(void)trusty_context_switch_helper(&ctx->saved_sp, &zero_args);
 
 	cm_el1_sysregs_context_restore(NON_SECURE);
+#if !CTX_LAZY_FPREGS
 	fpregs_context_restore(get_fpregs_ctx(cm_get_context(NON_SECURE)));
+#endif
 	cm_set_next_eret_context(NON_SECURE);
 
 	return 1;
@@ -462,6 +473,10 @@ static int32_t trusty_setup(void)
 	(void)mmap_remove_dynamic_region(ep_info->pc, PAGE_SIZE);
 
 	SET_PARAM_HEAD(ep_info, PARAM_EP, VERSION_1, SECURE | EP_ST_ENABLE);
+#if CTX_LAZY_FPREGS
+	/* The FP registers are not saved around calls to Trusty in this case */
+	EP_SET_FPREGS_LAZY(ep_info->h.attr, EP_FPREGS_LAZY);
+#endif
 	if (!aarch32)
 		ep_info->spsr = SPSR_64(MODE_EL1, MODE_SP_ELX,
 					DISABLE_ALL_EXCEPTIONS);
@@ -3,10 +3,12 @@
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
 #include <common/debug.h>
+#include <lib/el3_runtime/pubsub.h>
 #include <lib/spinlock.h>
 #include <lib/xlat_tables/xlat_tables_v2.h>
 #include <plat/common/platform.h>
@@ -15,6 +17,157 @@
 
 static spinlock_t lock;
 
+/*
+ * Realm attestation key, derived once by the platform when RMM is initialised.
+ * It is only written by the primary CPU before RMM is first entered, so it can
+ * be read without holding the lock afterwards. A size of 0 means that the key
+ * could not be derived at boot and has to be requested from the platform on
+ * every call.
+ */
+static uint8_t realm_attest_key[RMMD_ATTEST_KEY_MAX_SIZE];
+static size_t realm_attest_key_size;
+
+#if RMMD_ATTEST_TOKEN_CACHE
+/*
+ * Cache of the platform tokens returned for the last challenges. The challenge
+ * is itself a hash, so its first bytes are used as a key to discard entries
+ * before comparing whole challenges.
+ */
+typedef struct rmmd_token_cache_entry {
+	uint64_t key;
+	uint64_t last_use;
+	size_t c_size;
+	size_t token_size;	/* 0 for an unused entry */
+	uint8_t challenge[SHA512_DIGEST_SIZE];
+	uint8_t token[RMMD_ATTEST_TOKEN_CACHE_MAX_SIZE];
+} rmmd_token_cache_entry_t;
+
+static rmmd_token_cache_entry_t token_cache[RMMD_ATTEST_TOKEN_CACHE];
+static spinlock_t token_cache_lock;
+static uint64_t token_cache_clock;
+
+/*
+ * Incremented when the cache is invalidated, so that a token requested before
+ * a measurement change is not inserted afterwards.
+ */
+static uint64_t token_cache_gen;
+
+static uint64_t token_cache_key(const uint8_t *challenge)
+{
+	uint64_t key;
+
+	/* All the supported challenge sizes are larger than the key */
+	(void)memcpy(&key, challenge, sizeof(key));
+
+	return key;
+}
+
+/*
+ * Copy the token cached for a challenge to the token buffer. Return true on a
+ * hit, false if there is no such token or if it does not fit in the buffer.
+ * The generation of the cache is returned in 'gen' on a miss.
+ */
+static bool token_cache_lookup(const uint8_t *challenge, size_t c_size,
+			       uint64_t buf_pa, uint64_t *buf_size,
+			       uint64_t *gen)
+{
+	uint64_t key = token_cache_key(challenge);
+	rmmd_token_cache_entry_t *entry;
+	bool hit = false;
+	unsigned int i;
+
+	spin_lock(&token_cache_lock);
+
+	for (i = 0U; i < RMMD_ATTEST_TOKEN_CACHE; i++) {
+		entry = &token_cache[i];
+
+		if ((entry->token_size == 0UL) || (entry->key != key) ||
+		    (entry->c_size != c_size) ||
+		    (memcmp(entry->challenge, challenge, c_size) != 0)) {
+			continue;
+		}
+
+		if (entry->token_size <= *buf_size) {
+			(void)memcpy((void *)buf_pa, entry->token,
+				     entry->token_size);
+			*buf_size = entry->token_size;
+			entry->last_use = ++token_cache_clock;
+			hit = true;
+		}
+		break;
+	}
+
+	*gen = token_cache_gen;
+
+	spin_unlock(&token_cache_lock);
+
+	return hit;
+}
+
+/*
+ * Insert the token returned for a challenge in the cache, evicting the least
+ * recently used entry. Nothing is done if the cache has been invalidated since
+ * generation 'gen' or if the token is too large to be cached.
+ */
+static void token_cache_insert(const uint8_t *challenge, size_t c_size,
+			       uint64_t buf_pa, size_t token_size,
+			       uint64_t gen)
+{
+	rmmd_token_cache_entry_t *entry = &token_cache[0];
+	unsigned int i;
+
+	if ((token_size == 0UL) ||
+	    (token_size > RMMD_ATTEST_TOKEN_CACHE_MAX_SIZE)) {
+		return;
+	}
+
+	spin_lock(&token_cache_lock);
+
+	if (gen != token_cache_gen) {
+		spin_unlock(&token_cache_lock);
+		return;
+	}
+
+	for (i = 1U; i < RMMD_ATTEST_TOKEN_CACHE; i++) {
+		if (token_cache[i].last_use < entry->last_use) {
+			entry = &token_cache[i];
+		}
+	}
+
+	entry->key = token_cache_key(challenge);
+	entry->last_use = ++token_cache_clock;
+	entry->c_size = c_size;
+	entry->token_size = token_size;
+	(void)memcpy(entry->challenge, challenge, c_size);
+	(void)memcpy(entry->token, (void *)buf_pa, token_size);
+
+	spin_unlock(&token_cache_lock);
+}
+
+/*
+ * The platform token includes the boot measurements, so all the cached tokens
+ * become stale when a measurement is extended.
+ */
+static void *token_cache_invalidate(const void *arg)
+{
+	unsigned int i;
+
+	spin_lock(&token_cache_lock);
+
+	for (i = 0U; i < RMMD_ATTEST_TOKEN_CACHE; i++) {
+		token_cache[i].token_size = 0UL;
+		token_cache[i].last_use = 0UL;
+	}
+	token_cache_gen++;
+
+	spin_unlock(&token_cache_lock);
+
+	return NULL;
+}
+
+SUBSCRIBE_TO_EVENT(measurement_extended, token_cache_invalidate);
+#endif /* RMMD_ATTEST_TOKEN_CACHE */
+
 /* For printing Realm attestation token hash */
 #define DIGITS_PER_BYTE				2UL
 #define LENGTH_OF_TERMINATING_ZERO_IN_BYTES	1UL
@@ -60,7 +213,7 @@ static void print_challenge(uint8_t *hash, size_t hash_size)
  * Helper function to validate that the buffer base and length are
  * within range.
  */
-static int validate_buffer_params(uint64_t buf_pa, uint64_t buf_len)
+int rmmd_validate_buffer_params(uint64_t buf_pa, uint64_t buf_len)
 {
 	unsigned long shared_buf_page;
 	uintptr_t shared_buf_base;
@@ -84,13 +237,21 @@ static int validate_buffer_params(uint64_t buf_pa, uint64_t buf_len)
 	return 0; /* No error */
 }
 
+/*
+ * Get the platform token for the challenge found at the start of the token
+ * buffer. When 'async' is set, E_RMM_AGAIN is returned instead of waiting for
+ * another CPU to complete its own request to the platform.
+ */
 int rmmd_attest_get_platform_token(uint64_t buf_pa, uint64_t *buf_size,
-				   uint64_t c_size)
+				   uint64_t c_size, bool async)
 {
 	int err;
 	uint8_t temp_buf[SHA512_DIGEST_SIZE];
+#if RMMD_ATTEST_TOKEN_CACHE
+	uint64_t gen;
+#endif
 
-	err = validate_buffer_params(buf_pa, *buf_size);
+	err = rmmd_validate_buffer_params(buf_pa, *buf_size);
 	if (err != 0) {
 		return err;
 	}
@@ -102,10 +263,22 @@ int rmmd_attest_get_platform_token(uint64_t buf_pa, uint64_t *buf_size,
 		return E_RMM_INVAL;
 	}
 
-	spin_lock(&lock);
-
 	(void)memcpy(temp_buf, (void *)buf_pa, c_size);
 
+#if RMMD_ATTEST_TOKEN_CACHE
+	if (token_cache_lookup(temp_buf, c_size, buf_pa, buf_size, &gen)) {
+		return E_RMM_OK;
+	}
+#endif
+
+	if (async) {
+		if (!spin_trylock(&lock)) {
+			return E_RMM_AGAIN;
+		}
+	} else {
+		spin_lock(&lock);
+	}
+
 	print_challenge((uint8_t *)temp_buf, c_size);
 
 	/* Get the platform token. */
@@ -119,15 +292,39 @@ int rmmd_attest_get_platform_token(uint64_t buf_pa, uint64_t *buf_size,
 
 	spin_unlock(&lock);
 
+#if RMMD_ATTEST_TOKEN_CACHE
+	if (err == 0) {
+		token_cache_insert(temp_buf, c_size, buf_pa, *buf_size, gen);
+	}
+#endif
+
 	return err;
 }
 
+void rmmd_attest_init(void)
+{
+	size_t len = sizeof(realm_attest_key);
+	int err;
+
+	/* Derive the only supported key once for all the RMM requests */
+	err = plat_rmmd_get_cca_realm_attest_key((uintptr_t)realm_attest_key,
+						 &len,
+						 ATTEST_KEY_CURVE_ECC_SECP384R1);
+	if (err != 0) {
+		WARN("RMMD: Failed to derive attestation key at boot: %d.\n",
+		     err);
+		return;
+	}
+
+	realm_attest_key_size = len;
+}
+
 int rmmd_attest_get_signing_key(uint64_t buf_pa, uint64_t *buf_size,
 				uint64_t ecc_curve)
 {
 	int err;
 
-	err = validate_buffer_params(buf_pa, *buf_size);
+	err = rmmd_validate_buffer_params(buf_pa, *buf_size);
 	if (err != 0) {
 		return err;
 	}
@@ -137,6 +334,19 @@ int rmmd_attest_get_signing_key(uint64_t buf_pa, uint64_t *buf_size,
 		return E_RMM_INVAL;
 	}
 
+	if (realm_attest_key_size != 0UL) {
+		if (*buf_size < realm_attest_key_size) {
+			ERROR("Attestation key buffer too small\n");
+			return E_RMM_UNK;
+		}
+
+		(void)memcpy((void *)buf_pa, realm_attest_key,
+			     realm_attest_key_size);
+		*buf_size = realm_attest_key_size;
+
+		return E_RMM_OK;
+	}
+
 	spin_lock(&lock);
 
 	/* Get the Realm attestation key. */
@@ -19,6 +19,8 @@
 #include <lib/el3_runtime/context_mgmt.h>
 #include <lib/el3_runtime/pubsub.h>
 #include <lib/gpt_rme/gpt_rme.h>
+#include <lib/pmf/pmf.h>
+#include <lib/runtime_instr.h>
 
 #include <lib/spinlock.h>
 #include <lib/utils.h>
@@ -37,6 +39,23 @@
  ******************************************************************************/
 static bool rmm_boot_failed;
 
+/*******************************************************************************
+ * Capabilities advertised by the RMM with RMM_BOOT_SET_CAPS during cold boot.
+ * They cannot change once the primary CPU has booted the RMM.
+ ******************************************************************************/
+static uint64_t rmm_caps;
+static bool rmm_caps_locked;
+
+/*******************************************************************************
+ * The EL1 system registers are only left alone on a world switch if the RMM
+ * has advertised that it preserves the Non-secure ones.
+ ******************************************************************************/
+static bool rmmd_lazy_el2_ctx(void)
+{
+	return (RMMD_LAZY_EL2_CTX != 0) &&
+	       ((rmm_caps & RMM_CAP_PRESERVES_NS_EL1) != 0UL);
+}
+
 /*******************************************************************************
  * RMM context information.
  ******************************************************************************/
@@ -137,6 +156,9 @@ static int32_t rmm_init(void)
 
 	INFO("RMM init start.\n");
 
+	/* Derive the realm attestation key before RMM can request it */
+	rmmd_attest_init();
+
 	/* Enable architecture extensions */
 	manage_extensions_realm(&ctx->cpu_ctx);
 
@@ -144,6 +166,9 @@ static int32_t rmm_init(void)
 	rmm_el2_context_init(&ctx->cpu_ctx.el2_sysregs_ctx);
 
 	rc = rmmd_rmm_sync_entry(ctx);
+
+	/* The RMM capabilities are fixed from now on */
+	rmm_caps_locked = true;
 	if (rc != E_RMM_BOOT_SUCCESS) {
 		ERROR("RMM init failed: %ld\n", rc);
 		/* Mark the boot as failed for all the CPUs */
@@ -151,6 +176,11 @@ static int32_t rmm_init(void)
 		return 0;
 	}
 
+	if ((RMMD_LAZY_EL2_CTX != 0) && !rmmd_lazy_el2_ctx()) {
+		WARN("RMMD: RMM does not preserve NS EL1 registers, "
+		     "RMMD_LAZY_EL2_CTX ignored\n");
+	}
+
 	INFO("RMM init end.\n");
 
 	return 1;
@@ -243,15 +273,40 @@ static uint64_t	rmmd_smc_forward(uint32_t src_sec_state,
 {
 	cpu_context_t *ctx = cm_get_context(dst_sec_state);
 
-	/* Save incoming security state */
-	cm_el1_sysregs_context_save(src_sec_state);
-	cm_el2_sysregs_context_save(src_sec_state);
+#if ENABLE_RUNTIME_INSTRUMENTATION
+	if (src_sec_state == NON_SECURE) {
+		PMF_CAPTURE_TIMESTAMP(rt_instr_svc, RT_INSTR_ENTER_RMI,
+				      PMF_NO_CACHE_MAINT);
+	}
+#endif
+
+	if (rmmd_lazy_el2_ctx()) {
+		/*
+		 * Both worlds run their own EL2 software, which manages the
+		 * EL1 registers of its world, and RMM preserves the Non-secure
+		 * EL1 registers across Realm execution, so EL1 is left
+		 * untouched. The EL2 registers that both worlds program with
+		 * the same value are not rewritten either.
+		 */
+		cm_el2_sysregs_context_switch(src_sec_state, dst_sec_state);
+	} else {
+		/* Save incoming security state */
+		cm_el1_sysregs_context_save(src_sec_state);
+		cm_el2_sysregs_context_save(src_sec_state);
 
-	/* Restore outgoing security state */
-	cm_el1_sysregs_context_restore(dst_sec_state);
-	cm_el2_sysregs_context_restore(dst_sec_state);
+		/* Restore outgoing security state */
+		cm_el1_sysregs_context_restore(dst_sec_state);
+		cm_el2_sysregs_context_restore(dst_sec_state);
+	}
 	cm_set_next_eret_context(dst_sec_state);
 
+#if ENABLE_RUNTIME_INSTRUMENTATION
+	if (dst_sec_state == NON_SECURE) {
+		PMF_CAPTURE_TIMESTAMP(rt_instr_svc, RT_INSTR_EXIT_RMI,
+				      PMF_NO_CACHE_MAINT);
+	}
+#endif
+
 	/*
 	 * As per SMCCCv1.2, we need to preserve x4 to x7 unless
 	 * being used as return args. Hence we differentiate the
@@ -270,6 +325,71 @@ static uint64_t	rmmd_smc_forward(uint32_t src_sec_state,
 	SMC_RET5(ctx, x0, x1, x2, x3, x4);
 }
 
+#if RMMD_RMI_QUEUE
+/*******************************************************************************
+ * Handle an RMM_RMI_QUEUE_DOORBELL call from the Normal world. The RMM is
+ * entered synchronously once for the whole queue, so that the Normal world
+ * context is only switched out and back in once for all the commands. The RMM
+ * returns with RMM_RMI_REQ_COMPLETE when it has processed the queue, and its
+ * results are forwarded to the Normal world. The call is unknown if the RMM
+ * has not advertised that it supports RMI command queues.
+ ******************************************************************************/
+static uint64_t rmmd_rmi_queue_doorbell(uint64_t queue_pa, uint64_t cnt,
+					void *handle)
+{
+	rmmd_rmm_context_t *ctx = &rmm_context[plat_my_core_pos()];
+	uint64_t processed;
+	uint64_t rc;
+
+	if ((rmm_caps & RMM_CAP_RMI_QUEUE) == 0UL) {
+		SMC_RET2(handle, SMC_UNK, 0UL);
+	}
+
+	if (((queue_pa & (RMI_QUEUE_SIZE - 1UL)) != 0UL) || (cnt == 0UL) ||
+	    (cnt > RMI_QUEUE_MAX_ENTRIES)) {
+		SMC_RET2(handle, RMI_ERROR_INPUT, 0UL);
+	}
+
+#if ENABLE_RUNTIME_INSTRUMENTATION
+	PMF_CAPTURE_TIMESTAMP(rt_instr_svc, RT_INSTR_ENTER_RMI,
+			      PMF_NO_CACHE_MAINT);
+#endif
+
+	/* Save the Normal world context until the queue has been drained */
+	cm_el1_sysregs_context_save(NON_SECURE);
+	cm_el2_sysregs_context_save(NON_SECURE);
+
+	/* Pass the queue to the RMM as the result of its last SMC */
+	SMC_SET_GP(&ctx->cpu_ctx, CTX_GPREG_X0, RMM_RMI_QUEUE_DOORBELL);
+	SMC_SET_GP(&ctx->cpu_ctx, CTX_GPREG_X1, queue_pa);
+	SMC_SET_GP(&ctx->cpu_ctx, CTX_GPREG_X2, cnt);
+
+	ctx->rmi_queue_busy = true;
+	rc = rmmd_rmm_sync_entry(ctx);
+	ctx->rmi_queue_busy = false;
+
+	cm_el1_sysregs_context_restore(NON_SECURE);
+	cm_el2_sysregs_context_restore(NON_SECURE);
+	cm_set_next_eret_context(NON_SECURE);
+
+#if ENABLE_RUNTIME_INSTRUMENTATION
+	PMF_CAPTURE_TIMESTAMP(rt_instr_svc, RT_INSTR_EXIT_RMI,
+			      PMF_NO_CACHE_MAINT);
+#endif
+
+	/*
+	 * The number of commands processed is in x2 of RMM_RMI_REQ_COMPLETE,
+	 * unless the RMM rejected the doorbell as a whole.
+	 */
+	processed = SMC_GET_GP(&ctx->cpu_ctx, CTX_GPREG_X2);
+	if ((rc == (uint64_t)SMC_UNK) || (processed > cnt)) {
+		processed = 0UL;
+	}
+
+	SMC_RET2(handle, rc, processed);
+}
+#endif /* RMMD_RMI_QUEUE */
+
 /*******************************************************************************
  * This function handles all SMCs in the range reserved for RMI. Each call is
  * either forwarded to the other security state or handled by the RMM dispatcher
@@ -301,6 +421,11 @@ uint64_t rmmd_rmi_handler(uint32_t smc_fid, uint64_t x1, uint64_t x2,
 	 */
 	if (src_sec_state == SMC_FROM_NON_SECURE) {
 		VERBOSE("RMMD: RMI call from non-secure world.\n");
+#if RMMD_RMI_QUEUE
+		if (smc_fid == RMM_RMI_QUEUE_DOORBELL) {
+			return rmmd_rmi_queue_doorbell(x1, x2, handle);
+		}
+#endif
 		return rmmd_smc_forward(NON_SECURE, REALM, smc_fid,
 					x1, x2, x3, x4, handle);
 	}
@@ -313,6 +438,12 @@ uint64_t rmmd_rmi_handler(uint32_t smc_fid, uint64_t x1, uint64_t x2,
 	case RMM_RMI_REQ_COMPLETE: {
 		uint64_t x5 = SMC_GET_GP(handle, CTX_GPREG_X5);
 
+#if RMMD_RMI_QUEUE
+		/* Return to rmmd_rmi_queue_doorbell() once the queue is drained */
+		if (rmm_context[plat_my_core_pos()].rmi_queue_busy) {
+			rmmd_rmm_sync_exit(x1);
+		}
+#endif
 		return rmmd_smc_forward(REALM, NON_SECURE, x1,
 					x2, x3, x4, x5, handle);
 	}
@@ -384,6 +515,9 @@ static int gpt_to_gts_error(int error, uint32_t smc_fid, uint64_t address)
 
 	if (error == -EINVAL) {
 		ret = E_RMM_BAD_ADDR;
+	} else if (error == -ENOMEM) {
+		/* No L1 GPT left to describe the granules */
+		ret = E_RMM_NOMEM;
 	} else {
 		/* This is the only other error code we expect */
 		assert(error == -EPERM);
@@ -395,6 +529,77 @@ static int gpt_to_gts_error(int error, uint32_t smc_fid, uint64_t address)
 	return ret;
 }
 
+/*******************************************************************************
+ * Transition a range of granules on behalf of the RMM. The request is clipped
+ * to the next RMMD_GTSI_RANGE_MAX_SIZE boundary so that a single call does not
+ * hold the GPT lock for an unbounded amount of time. The number of bytes
+ * transitioned is returned in `done`, and the RMM is expected to reissue the
+ * call for the rest of the range.
+ ******************************************************************************/
+static int rmmd_gtsi_range(uint32_t smc_fid, uint64_t base, uint64_t size,
+			   uint64_t *done)
+{
+	uint64_t chunk;
+	int ret;
+
+	*done = 0UL;
+
+	/* Clip the request to the next RMMD_GTSI_RANGE_MAX_SIZE boundary */
+	chunk = RMMD_GTSI_RANGE_MAX_SIZE -
+		(base & (RMMD_GTSI_RANGE_MAX_SIZE - 1U));
+	if (size < chunk) {
+		chunk = size;
+	}
+
+	if (smc_fid == RMM_GTSI_DELEGATE_RANGE) {
+		ret = gpt_delegate_pas(base, chunk, SMC_FROM_REALM);
+	} else {
+		ret = gpt_undelegate_pas(base, chunk, SMC_FROM_REALM);
+	}
+
+	if (ret == 0) {
+		*done = chunk;
+	}
+
+	return gpt_to_gts_error(ret, smc_fid, base);
+}
+
+/*******************************************************************************
+ * Read the GPIs of a range of granules into a buffer within the RMM-EL3 shared
+ * buffer. The range is clipped to the number of GPIs that fit in the buffer,
+ * and the number of granules reported is returned in `cnt`.
+ ******************************************************************************/
+static int rmmd_gtsi_query_range(uint64_t buf_pa, uint64_t buf_size,
+				 uint64_t base, uint64_t *cnt)
+{
+	uint64_t max_cnt;
+	int ret;
+
+	if (((buf_pa & (sizeof(uint64_t) - 1UL)) != 0UL) ||
+	    (buf_size < sizeof(uint64_t))) {
+		*cnt = 0UL;
+		return E_RMM_INVAL;
+	}
+
+	ret = rmmd_validate_buffer_params(buf_pa, buf_size);
+	if (ret != 0) {
+		*cnt = 0UL;
+		return ret;
+	}
+
+	max_cnt = (buf_size / sizeof(uint64_t)) * RMM_GTSI_QUERY_GPIS_PER_WORD;
+	if (*cnt > max_cnt) {
+		*cnt = max_cnt;
+	}
+
+	if (gpt_get_gpis(base, *cnt, (uint64_t *)buf_pa) != 0) {
+		*cnt = 0UL;
+		return E_RMM_BAD_ADDR;
+	}
+
+	return E_RMM_OK;
+}
+
 /*******************************************************************************
  * This function handles RMM-EL3 interface SMCs
  ******************************************************************************/
@@ -426,13 +631,34 @@ uint64_t rmmd_rmm_el3_handler(uint32_t smc_fid, uint64_t x1, uint64_t x2,
 	case RMM_GTSI_UNDELEGATE:
 		ret = gpt_undelegate_pas(x1, PAGE_SIZE_4KB, SMC_FROM_REALM);
 		SMC_RET1(handle, gpt_to_gts_error(ret, smc_fid, x1));
+	case RMM_GTSI_DELEGATE_RANGE:
+	case RMM_GTSI_UNDELEGATE_RANGE:
+		ret = rmmd_gtsi_range(smc_fid, x1, x2, &x2);
+		SMC_RET2(handle, ret, x2);
+	case RMM_GTSI_QUERY:
+		if (gpt_get_gpis(x1, 1UL, &x2) != 0) {
+			SMC_RET2(handle, E_RMM_BAD_ADDR, 0UL);
+		}
+		SMC_RET2(handle, E_RMM_OK, x2);
+	case RMM_GTSI_QUERY_RANGE:
+		ret = rmmd_gtsi_query_range(x1, x2, x3, &x4);
+		SMC_RET2(handle, ret, x4);
 	case RMM_ATTEST_GET_PLAT_TOKEN:
-		ret = rmmd_attest_get_platform_token(x1, &x2, x3);
+		ret = rmmd_attest_get_platform_token(x1, &x2, x3, false);
+		SMC_RET2(handle, ret, x2);
+	case RMM_ATTEST_GET_PLAT_TOKEN_ASYNC:
+		ret = rmmd_attest_get_platform_token(x1, &x2, x3, true);
 		SMC_RET2(handle, ret, x2);
 	case RMM_ATTEST_GET_REALM_KEY:
 		ret = rmmd_attest_get_signing_key(x1, &x2, x3);
 		SMC_RET2(handle, ret, x2);
 
+	case RMM_BOOT_SET_CAPS:
+		if (rmm_caps_locked) {
+			SMC_RET1(handle, E_RMM_UNK);
+		}
+		rmm_caps = x1;
+		SMC_RET1(handle, E_RMM_OK);
 	case RMM_BOOT_COMPLETE:
 		VERBOSE("RMMD: running rmmd_rmm_sync_exit\n");
 		rmmd_rmm_sync_exit(x1);
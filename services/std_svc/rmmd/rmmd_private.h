@@ -29,7 +29,27 @@
 #define RMMD_C_RT_CTX_SIZE		0x60
 #define RMMD_C_RT_CTX_ENTRIES		(RMMD_C_RT_CTX_SIZE >> DWORD_SHIFT)
 
+/*******************************************************************************
+ * Maximum number of bytes transitioned by a single RMM_GTSI_DELEGATE_RANGE or
+ * RMM_GTSI_UNDELEGATE_RANGE call. This bounds the time spent in EL3, with the
+ * GPT lock held, by one request. The RMM reissues the call for the remainder
+ * of the range.
+ ******************************************************************************/
+#define RMMD_GTSI_RANGE_MAX_SIZE	U(0x200000)
+
+/*******************************************************************************
+ * Largest platform token kept in the attestation token cache. Larger tokens are
+ * still returned to the RMM but are fetched from the platform every time.
+ ******************************************************************************/
+#define RMMD_ATTEST_TOKEN_CACHE_MAX_SIZE	U(0x800)
+
+/*******************************************************************************
+ * Size of the buffer holding the realm attestation key derived at boot.
+ ******************************************************************************/
+#define RMMD_ATTEST_KEY_MAX_SIZE		U(0x100)
+
 #ifndef __ASSEMBLER__
+#include <stdbool.h>
 #include <stdint.h>
 
 /*
@@ -39,17 +59,25 @@
 typedef struct rmmd_rmm_context {
 	uint64_t c_rt_ctx;
 	cpu_context_t cpu_ctx;
+#if RMMD_RMI_QUEUE
+	/* The RMM has been entered synchronously to drain an RMI queue */
+	bool rmi_queue_busy;
+#endif
 } rmmd_rmm_context_t;
 
 /* Functions used to enter/exit the RMM synchronously */
 uint64_t rmmd_rmm_sync_entry(rmmd_rmm_context_t *ctx);
 __dead2 void rmmd_rmm_sync_exit(uint64_t rc);
 
+/* Validate that a buffer lies within the RMM-EL3 shared buffer */
+int rmmd_validate_buffer_params(uint64_t buf_pa, uint64_t buf_len);
+
 /* Functions implementing attestation utilities for RMM */
 int rmmd_attest_get_platform_token(uint64_t buf_pa, uint64_t *buf_size,
-				   uint64_t c_size);
+				   uint64_t c_size, bool async);
 int rmmd_attest_get_signing_key(uint64_t buf_pa, uint64_t *buf_size,
 				uint64_t ecc_curve);
+void rmmd_attest_init(void);
 
 /* Assembly helpers */
 uint64_t rmmd_rmm_enter(uint64_t *c_rt_ctx);
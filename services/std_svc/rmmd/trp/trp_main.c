@@ -63,6 +63,10 @@ void trp_setup(uint64_t x0,
 
 	/* Perform early platform-specific setup */
 	trp_early_platform_setup((struct rmm_manifest *)trp_shared_region_start);
+
+	/* The TRP never accesses the EL1 system registers */
+	(void)trp_smc(set_smc_args(RMM_BOOT_SET_CAPS, RMM_CAP_PRESERVES_NS_EL1,
+				   0UL, 0UL, 0UL, 0UL, 0UL, 0UL));
 }
 
 int trp_validate_warmboot_args(uint64_t x0, uint64_t x1,
@@ -31,7 +31,34 @@
 #include <platform_def.h>
 
 /* Declare the maximum number of SPs and El3 LPs. */
-#define MAX_SP_LP_PARTITIONS SECURE_PARTITION_COUNT + MAX_EL3_LP_DESCS_COUNT
+#define MAX_SP_LP_PARTITIONS (SECURE_PARTITION_COUNT + MAX_EL3_LP_DESCS_COUNT)
+
+/*
+ * Map from the partition IDs of the SPs and EL3 Logical Partitions to their
+ * descriptors. It is built once the IDs of all partitions are known, with a
+ * multiplicative hash whose multiplier is chosen so that every partition has a
+ * slot of its own. A lookup is then a single slot computation and compare. If
+ * there are too many partitions to keep the map sparse, or no such multiplier
+ * exists, the descriptors keep being searched linearly.
+ */
+#define SPMC_PARTITION_MAP_SHIFT	U(6)
+#define SPMC_PARTITION_MAP_SIZE		(U(1) << SPMC_PARTITION_MAP_SHIFT)
+
+#define SPMC_PARTITION_NONE		U(0)
+#define SPMC_PARTITION_SP		U(1)
+#define SPMC_PARTITION_EL3_LP		U(2)
+
+struct spmc_partition_map_entry {
+	uint16_t id;
+	uint8_t type;
+	uint8_t index;
+};
+
+static struct spmc_partition_map_entry
+	partition_map[SPMC_PARTITION_MAP_SIZE];
+
+/* Multiplier of the partition map hash, 0 until the map is built. */
+static uint32_t partition_map_mult;
 
 /*
  * Allocate a secure partition descriptor to describe each SP in the system that
@@ -80,16 +107,119 @@ struct sp_exec_ctx *spmc_get_sp_ec(struct secure_partition_desc *sp)
 	return &(sp->ec[get_ec_index(sp)]);
 }
 
-/* Helper function to get pointer to SP context from its ID. */
-struct secure_partition_desc *spmc_get_sp_ctx(uint16_t id)
+static unsigned int spmc_partition_map_slot(uint16_t id, uint32_t mult)
+{
+	return (uint16_t)(id * mult) >> (16U - SPMC_PARTITION_MAP_SHIFT);
+}
+
+/*
+ * Helper function to build the partition map once the IDs of all SPs and EL3
+ * Logical Partitions have been assigned.
+ */
+static void spmc_partition_map_build(void)
+{
+	struct el3_lp_desc *el3_lp_descs = get_el3_lp_array();
+	struct spmc_partition_map_entry *entry;
+	unsigned int count = 0U;
+	uint16_t ids[MAX_SP_LP_PARTITIONS];
+	uint8_t types[MAX_SP_LP_PARTITIONS];
+	uint8_t indices[MAX_SP_LP_PARTITIONS];
+
+	for (unsigned int i = 0U; i < EL3_LP_DESCS_COUNT; i++) {
+		ids[count] = el3_lp_descs[i].sp_id;
+		types[count] = SPMC_PARTITION_EL3_LP;
+		indices[count++] = i;
+	}
+
+	for (unsigned int i = 0U; i < SECURE_PARTITION_COUNT; i++) {
+		if (sp_desc[i].sp_id == INV_SP_ID) {
+			continue;
+		}
+		ids[count] = sp_desc[i].sp_id;
+		types[count] = SPMC_PARTITION_SP;
+		indices[count++] = i;
+	}
+
+	/* Keep the map sparse enough to find a collision free multiplier. */
+	if ((count * 4U) > SPMC_PARTITION_MAP_SIZE) {
+		WARN("Too many partitions for the partition ID map, using linear search.\n");
+		return;
+	}
+
+	/* Only odd multipliers keep the low bits of the IDs significant. */
+	for (uint32_t mult = 1U; mult <= UINT16_MAX; mult += 2U) {
+		unsigned int i;
+
+		zeromem(partition_map, sizeof(partition_map));
+		for (i = 0U; i < count; i++) {
+			entry = &partition_map[spmc_partition_map_slot(ids[i],
+								       mult)];
+			if (entry->type != SPMC_PARTITION_NONE) {
+				break;
+			}
+			entry->id = ids[i];
+			entry->type = types[i];
+			entry->index = indices[i];
+		}
+
+		if (i == count) {
+			partition_map_mult = mult;
+			return;
+		}
+	}
+
+	zeromem(partition_map, sizeof(partition_map));
+	WARN("Unable to build the partition ID map, using linear search.\n");
+}
+
+/*
+ * Helper function to find the SP or EL3 Logical Partition with a given ID.
+ * Returns the type of the partition and its index in the array of descriptors
+ * of that type. The descriptors are searched linearly until the partition map
+ * is built during SPMC setup.
+ */
+static unsigned int spmc_partition_find(uint16_t id, unsigned int *index)
 {
-	/* Check for Secure World Partitions. */
+	struct el3_lp_desc *el3_lp_descs;
+	struct spmc_partition_map_entry *entry;
+
+	if (partition_map_mult != 0U) {
+		entry = &partition_map[spmc_partition_map_slot(id,
+						partition_map_mult)];
+		if ((entry->type == SPMC_PARTITION_NONE) || (entry->id != id)) {
+			return SPMC_PARTITION_NONE;
+		}
+		*index = entry->index;
+		return entry->type;
+	}
+
 	for (unsigned int i = 0U; i < SECURE_PARTITION_COUNT; i++) {
 		if (sp_desc[i].sp_id == id) {
-			return &(sp_desc[i]);
+			*index = i;
+			return SPMC_PARTITION_SP;
 		}
 	}
-	return NULL;
+
+	el3_lp_descs = get_el3_lp_array();
+	for (unsigned int i = 0U; i < EL3_LP_DESCS_COUNT; i++) {
+		if (el3_lp_descs[i].sp_id == id) {
+			*index = i;
+			return SPMC_PARTITION_EL3_LP;
+		}
+	}
+
+	return SPMC_PARTITION_NONE;
+}
+
+/* Helper function to get pointer to SP context from its ID. */
+struct secure_partition_desc *spmc_get_sp_ctx(uint16_t id)
+{
+	unsigned int index;
+
+	if (spmc_partition_find(id, &index) != SPMC_PARTITION_SP) {
+		return NULL;
+	}
+	return &(sp_desc[index]);
 }
 
 /*
@@ -149,7 +279,7 @@ uint64_t spmc_ffa_error_return(void *handle, int error_code)
  ******************************************************************************/
 bool is_ffa_secure_id_valid(uint16_t partition_id)
 {
-	struct el3_lp_desc *el3_lp_descs = get_el3_lp_array();
+	unsigned int index;
 
 	/* Ensure the ID is not the invalid partition ID. */
 	if (partition_id == INV_SP_ID) {
@@ -174,18 +304,14 @@ bool is_ffa_secure_id_valid(uint16_t partition_id)
 		return false;
 	}
 
-	/* Ensure we do not already have an SP context with this ID. */
-	if (spmc_get_sp_ctx(partition_id)) {
+	/*
+	 * Ensure we do not already have an SP context or a Logical SP with
+	 * this ID.
+	 */
+	if (spmc_partition_find(partition_id, &index) != SPMC_PARTITION_NONE) {
 		return false;
 	}
 
-	/* Ensure we don't clash with any Logical SP's. */
-	for (unsigned int i = 0U; i < EL3_LP_DESCS_COUNT; i++) {
-		if (el3_lp_descs[i].sp_id == partition_id) {
-			return false;
-		}
-	}
-
 	return true;
 }
 
@@ -276,6 +402,7 @@ static uint64_t direct_req_smc_handler(uint32_t smc_fid,
 	struct el3_lp_desc *el3_lp_descs;
 	struct secure_partition_desc *sp;
 	unsigned int idx;
+	unsigned int type;
 
 	/* Check if arg2 has been populated correctly based on message type. */
 	if (!direct_msg_validate_arg2(x2)) {
@@ -283,15 +410,14 @@ static uint64_t direct_req_smc_handler(uint32_t smc_fid,
 					     FFA_ERROR_INVALID_PARAMETER);
 	}
 
-	el3_lp_descs = get_el3_lp_array();
+	type = spmc_partition_find(dst_id, &idx);
 
 	/* Check if the request is destined for a Logical Partition. */
-	for (unsigned int i = 0U; i < MAX_EL3_LP_DESCS_COUNT; i++) {
-		if (el3_lp_descs[i].sp_id == dst_id) {
-			return el3_lp_descs[i].direct_req(
-					smc_fid, secure_origin, x1, x2, x3, x4,
-					cookie, handle, flags);
-		}
+	if (type == SPMC_PARTITION_EL3_LP) {
+		el3_lp_descs = get_el3_lp_array();
+		return el3_lp_descs[idx].direct_req(smc_fid, secure_origin, x1,
+						    x2, x3, x4, cookie, handle,
+						    flags);
 	}
 
 	/*
@@ -307,13 +433,13 @@ static uint64_t direct_req_smc_handler(uint32_t smc_fid,
 	}
 
 	/* Check if the SP ID is valid. */
-	sp = spmc_get_sp_ctx(dst_id);
-	if (sp == NULL) {
+	if (type != SPMC_PARTITION_SP) {
 		VERBOSE("Direct request to unknown partition ID (0x%x).\n",
 			dst_id);
 		return spmc_ffa_error_return(handle,
 					     FFA_ERROR_INVALID_PARAMETER);
 	}
+	sp = &(sp_desc[idx]);
 
 	/*
 	 * Check that the target execution context is in a waiting state before
@@ -1814,6 +1940,7 @@ int32_t spmc_setup(void)
 		return ret;
 	}
 	memset(spmc_shmem_obj_state.data, 0, spmc_shmem_obj_state.data_size);
+	spmc_shmem_obj_state_init(&spmc_shmem_obj_state);
 
 	/* Setup logical SPs. */
 	ret = logical_sp_init();
@@ -1836,6 +1963,9 @@ int32_t spmc_setup(void)
 		return ret;
 	}
 
+	/* Now that all partition IDs are assigned, index them. */
+	spmc_partition_map_build();
+
 	/* Register power management hooks with PSCI */
 	psci_register_spd_pm_hook(&spmc_pm);
 
@@ -19,6 +19,16 @@
 
 /**
  * struct spmc_shmem_obj - Shared memory object.
+ * @blk_size:       Size of the datastore block holding the object, including
+ *                  this header. Bit 0 is set when the block is free.
+ * @prev_blk_size:  Size of the previous block in the datastore, 0 for the
+ *                  first block.
+ * @next:           Next object in the same handle index bucket, or next free
+ *                  block in the same free list.
+ * @prev:           Previous free block in the same free list.
+ * @ranges:         Object holding the nodes of the interval index that
+ *                  describe the memory ranges of @desc, or %NULL if they are
+ *                  not in the index.
  * @desc_size:      Size of @desc.
  * @desc_filled:    Size of @desc already received.
  * @in_use:         Number of clients that have called ffa_mem_retrieve_req
@@ -26,12 +36,43 @@
  * @desc:           FF-A memory region descriptor passed in ffa_mem_share.
  */
 struct spmc_shmem_obj {
+	size_t blk_size;
+	size_t prev_blk_size;
+	struct spmc_shmem_obj *next;
+	struct spmc_shmem_obj *prev;
+	struct spmc_shmem_obj *ranges;
 	size_t desc_size;
 	size_t desc_filled;
 	size_t in_use;
 	struct ffa_mtd desc;
 };
 
+/**
+ * struct spmc_shmem_range - Node of the interval index of shared memory.
+ * @base:           Start address of the range.
+ * @end:            End address of the range, exclusive.
+ * @max_end:        Largest @end in the subtree rooted at this node.
+ * @left:           Subtree of the ranges ordered before this one.
+ * @right:          Subtree of the ranges ordered after this one.
+ * @height:         Height of the subtree rooted at this node.
+ *
+ * The index is an AVL tree of the constituent ranges of all the complete memory
+ * transactions, ordered by @base and augmented with @max_end so that an
+ * overlapping range can be found in logarithmic time.
+ */
+struct spmc_shmem_range {
+	uint64_t base;
+	uint64_t end;
+	uint64_t max_end;
+	struct spmc_shmem_range *left;
+	struct spmc_shmem_range *right;
+	unsigned int height;
+};
+
+/* Alignment of the datastore blocks, which leaves bit 0 of their size free */
+#define SPMC_SHMEM_BLK_ALIGN	U(16)
+#define SPMC_SHMEM_BLK_FREE	U(1)
+
 /*
  * Declare our data structure to store the metadata of memory share requests.
  * The main datastore is allocated on a per platform basis to ensure enough
@@ -49,11 +90,327 @@ struct spmc_shmem_obj_state spmc_shmem_obj_state = {
  * spmc_shmem_obj_size - Convert from descriptor size to object size.
  * @desc_size:  Size of struct ffa_memory_region_descriptor object.
  *
- * Return: Size of struct spmc_shmem_obj object.
+ * The descriptor area is never smaller than struct ffa_mtd, so that its header
+ * can be cleared and its handle read whatever @desc_size is.
+ *
+ * Return: Size of the datastore block holding a struct spmc_shmem_obj object.
  */
 static size_t spmc_shmem_obj_size(size_t desc_size)
 {
-	return desc_size + offsetof(struct spmc_shmem_obj, desc);
+	return round_up(MAX(desc_size, sizeof(struct ffa_mtd)) +
+			offsetof(struct spmc_shmem_obj, desc),
+			SPMC_SHMEM_BLK_ALIGN);
+}
+
+static size_t spmc_shmem_blk_size(const struct spmc_shmem_obj *blk)
+{
+	return blk->blk_size & ~(size_t)SPMC_SHMEM_BLK_FREE;
+}
+
+static bool spmc_shmem_blk_is_free(const struct spmc_shmem_obj *blk)
+{
+	return (blk->blk_size & SPMC_SHMEM_BLK_FREE) != 0U;
+}
+
+/**
+ * spmc_shmem_blk_next - Get the block following @blk in the datastore.
+ *
+ * Return: Next block, or %NULL if @blk is the last block of the datastore.
+ */
+static struct spmc_shmem_obj *
+spmc_shmem_blk_next(struct spmc_shmem_obj_state *state,
+		    struct spmc_shmem_obj *blk)
+{
+	uint8_t *next = (uint8_t *)blk + spmc_shmem_blk_size(blk);
+
+	if (next >= state->data + state->data_size) {
+		return NULL;
+	}
+	return (struct spmc_shmem_obj *)next;
+}
+
+/**
+ * spmc_shmem_blk_prev - Get the block preceding @blk in the datastore.
+ *
+ * Return: Previous block, or %NULL if @blk is the first block of the
+ *         datastore.
+ */
+static struct spmc_shmem_obj *
+spmc_shmem_blk_prev(struct spmc_shmem_obj *blk)
+{
+	if (blk->prev_blk_size == 0U) {
+		return NULL;
+	}
+	return (struct spmc_shmem_obj *)((uint8_t *)blk - blk->prev_blk_size);
+}
+
+/**
+ * spmc_shmem_free_list_idx - Get the free list holding blocks of a given size.
+ * @blk_size:   Size of the block.
+ *
+ * Free list n holds the blocks whose size is at least the size of an empty
+ * object times 2^n, the last list holding all the larger blocks.
+ *
+ * Return: Index of the free list.
+ */
+static unsigned int spmc_shmem_free_list_idx(size_t blk_size)
+{
+	unsigned int idx = 0U;
+
+	blk_size /= spmc_shmem_obj_size(0U);
+	while ((blk_size > 1U) && (idx < (SPMC_SHMEM_FREE_LISTS - 1U))) {
+		blk_size >>= 1;
+		idx++;
+	}
+	return idx;
+}
+
+static void spmc_shmem_free_list_add(struct spmc_shmem_obj_state *state,
+				     struct spmc_shmem_obj *blk)
+{
+	unsigned int idx = spmc_shmem_free_list_idx(spmc_shmem_blk_size(blk));
+
+	blk->blk_size |= SPMC_SHMEM_BLK_FREE;
+	blk->prev = NULL;
+	blk->next = state->free_list[idx];
+	if (blk->next != NULL) {
+		blk->next->prev = blk;
+	}
+	state->free_list[idx] = blk;
+}
+
+static void spmc_shmem_free_list_del(struct spmc_shmem_obj_state *state,
+				     struct spmc_shmem_obj *blk)
+{
+	unsigned int idx = spmc_shmem_free_list_idx(spmc_shmem_blk_size(blk));
+
+	if (blk->prev != NULL) {
+		blk->prev->next = blk->next;
+	} else {
+		state->free_list[idx] = blk->next;
+	}
+	if (blk->next != NULL) {
+		blk->next->prev = blk->prev;
+	}
+	blk->blk_size &= ~(size_t)SPMC_SHMEM_BLK_FREE;
+}
+
+static unsigned int spmc_shmem_range_height(const struct spmc_shmem_range *node)
+{
+	return (node == NULL) ? 0U : node->height;
+}
+
+static void spmc_shmem_range_update(struct spmc_shmem_range *node)
+{
+	unsigned int left_height = spmc_shmem_range_height(node->left);
+	unsigned int right_height = spmc_shmem_range_height(node->right);
+
+	node->height = MAX(left_height, right_height) + 1U;
+	node->max_end = node->end;
+	if ((node->left != NULL) && (node->left->max_end > node->max_end)) {
+		node->max_end = node->left->max_end;
+	}
+	if ((node->right != NULL) && (node->right->max_end > node->max_end)) {
+		node->max_end = node->right->max_end;
+	}
+}
+
+static struct spmc_shmem_range *
+spmc_shmem_range_rotate_right(struct spmc_shmem_range *node)
+{
+	struct spmc_shmem_range *left = node->left;
+
+	node->left = left->right;
+	left->right = node;
+	spmc_shmem_range_update(node);
+	spmc_shmem_range_update(left);
+	return left;
+}
+
+static struct spmc_shmem_range *
+spmc_shmem_range_rotate_left(struct spmc_shmem_range *node)
+{
+	struct spmc_shmem_range *right = node->right;
+
+	node->right = right->left;
+	right->left = node;
+	spmc_shmem_range_update(node);
+	spmc_shmem_range_update(right);
+	return right;
+}
+
+/**
+ * spmc_shmem_range_balance - Rebalance a subtree after an insertion or a
+ *                            removal in one of its children.
+ * @node:   Root of the subtree.
+ *
+ * Return: New root of the subtree.
+ */
+static struct spmc_shmem_range *
+spmc_shmem_range_balance(struct spmc_shmem_range *node)
+{
+	unsigned int left_height = spmc_shmem_range_height(node->left);
+	unsigned int right_height = spmc_shmem_range_height(node->right);
+
+	if (left_height > (right_height + 1U)) {
+		if (spmc_shmem_range_height(node->left->left) <
+		    spmc_shmem_range_height(node->left->right)) {
+			node->left = spmc_shmem_range_rotate_left(node->left);
+		}
+		return spmc_shmem_range_rotate_right(node);
+	}
+
+	if (right_height > (left_height + 1U)) {
+		if (spmc_shmem_range_height(node->right->right) <
+		    spmc_shmem_range_height(node->right->left)) {
+			node->right = spmc_shmem_range_rotate_right(node->right);
+		}
+		return spmc_shmem_range_rotate_left(node);
+	}
+
+	spmc_shmem_range_update(node);
+	return node;
+}
+
+/*
+ * Ranges are ordered by base address, and ranges with the same base address
+ * by node address, so that every node has a unique position in the tree.
+ */
+static bool spmc_shmem_range_before(const struct spmc_shmem_range *a,
+				    const struct spmc_shmem_range *b)
+{
+	if (a->base != b->base) {
+		return a->base < b->base;
+	}
+	return (uintptr_t)a < (uintptr_t)b;
+}
+
+static struct spmc_shmem_range *
+spmc_shmem_range_insert(struct spmc_shmem_range *root,
+			struct spmc_shmem_range *node)
+{
+	if (root == NULL) {
+		node->left = NULL;
+		node->right = NULL;
+		spmc_shmem_range_update(node);
+		return node;
+	}
+
+	if (spmc_shmem_range_before(node, root)) {
+		root->left = spmc_shmem_range_insert(root->left, node);
+	} else {
+		root->right = spmc_shmem_range_insert(root->right, node);
+	}
+	return spmc_shmem_range_balance(root);
+}
+
+static struct spmc_shmem_range *
+spmc_shmem_range_remove_first(struct spmc_shmem_range *root,
+			      struct spmc_shmem_range **first)
+{
+	if (root->left == NULL) {
+		*first = root;
+		return root->right;
+	}
+
+	root->left = spmc_shmem_range_remove_first(root->left, first);
+	return spmc_shmem_range_balance(root);
+}
+
+static struct spmc_shmem_range *
+spmc_shmem_range_remove(struct spmc_shmem_range *root,
+			struct spmc_shmem_range *node)
+{
+	struct spmc_shmem_range *next;
+	struct spmc_shmem_range *right;
+
+	assert(root != NULL);
+
+	if (root == node) {
+		if (node->left == NULL) {
+			return node->right;
+		}
+		if (node->right == NULL) {
+			return node->left;
+		}
+
+		/* Replace the node with the next one in the tree. */
+		right = spmc_shmem_range_remove_first(node->right, &next);
+		next->left = node->left;
+		next->right = right;
+		return spmc_shmem_range_balance(next);
+	}
+
+	if (spmc_shmem_range_before(node, root)) {
+		root->left = spmc_shmem_range_remove(root->left, node);
+	} else {
+		root->right = spmc_shmem_range_remove(root->right, node);
+	}
+	return spmc_shmem_range_balance(root);
+}
+
+/**
+ * spmc_shmem_range_find_overlap - Find a range of the index overlapping with
+ *                                 [@base, @end).
+ * @root:   Root of the interval index.
+ * @base:   Start address of the range to check.
+ * @end:    End address of the range to check, exclusive.
+ *
+ * Return: An overlapping range of the index, or %NULL if there is none.
+ */
+static struct spmc_shmem_range *
+spmc_shmem_range_find_overlap(struct spmc_shmem_range *root, uint64_t base,
+			      uint64_t end)
+{
+	struct spmc_shmem_range *node = root;
+
+	while (node != NULL) {
+		if ((node->base < end) && (base < node->end)) {
+			return node;
+		}
+
+		/*
+		 * If the left subtree has a range ending after @base but none
+		 * overlapping, that range starts after @end and so do all the
+		 * ranges of the right subtree.
+		 */
+		if ((node->left != NULL) && (node->left->max_end > base)) {
+			node = node->left;
+		} else {
+			node = node->right;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * spmc_shmem_obj_state_init - Initialize the datastore of @state.
+ * @state:      Global state, with @state->data and @state->data_size set to
+ *              the datastore provided by the platform.
+ *
+ * Turn the whole datastore into a single free block.
+ */
+void spmc_shmem_obj_state_init(struct spmc_shmem_obj_state *state)
+{
+	uintptr_t base = round_up((uintptr_t)state->data, SPMC_SHMEM_BLK_ALIGN);
+	size_t skip = base - (uintptr_t)state->data;
+	struct spmc_shmem_obj *blk;
+
+	if ((state->data == NULL) ||
+	    (state->data_size < skip + spmc_shmem_obj_size(0U))) {
+		state->data_size = 0U;
+		return;
+	}
+
+	state->data = (uint8_t *)base;
+	state->data_size = round_down(state->data_size - skip,
+				      SPMC_SHMEM_BLK_ALIGN);
+	state->allocated = 0U;
+
+	blk = (struct spmc_shmem_obj *)state->data;
+	blk->blk_size = state->data_size;
+	blk->prev_blk_size = 0U;
+	spmc_shmem_free_list_add(state, blk);
 }
 
 /**
@@ -70,9 +427,13 @@ static size_t spmc_shmem_obj_size(size_t desc_size)
 static struct spmc_shmem_obj *
 spmc_shmem_obj_alloc(struct spmc_shmem_obj_state *state, size_t desc_size)
 {
-	struct spmc_shmem_obj *obj;
+	struct spmc_shmem_obj *obj = NULL;
+	struct spmc_shmem_obj *blk;
+	struct spmc_shmem_obj *next;
 	size_t free = state->data_size - state->allocated;
 	size_t obj_size;
+	size_t blk_size;
+	unsigned int idx;
 
 	if (state->data == NULL) {
 		ERROR("Missing shmem datastore!\n");
@@ -88,45 +449,142 @@ spmc_shmem_obj_alloc(struct spmc_shmem_obj_state *state, size_t desc_size)
 		return NULL;
 	}
 
-	if (obj_size > free) {
+	/*
+	 * Take the first large enough block of the free list matching the
+	 * object size, or else any block of the lists of larger blocks.
+	 */
+	idx = spmc_shmem_free_list_idx(obj_size);
+	for (blk = state->free_list[idx]; blk != NULL; blk = blk->next) {
+		if (spmc_shmem_blk_size(blk) >= obj_size) {
+			obj = blk;
+			break;
+		}
+	}
+	for (idx++; (obj == NULL) && (idx < SPMC_SHMEM_FREE_LISTS); idx++) {
+		obj = state->free_list[idx];
+	}
+
+	if (obj == NULL) {
 		WARN("%s(0x%zx) failed, free 0x%zx\n",
 		     __func__, desc_size, free);
 		return NULL;
 	}
-	obj = (struct spmc_shmem_obj *)(state->data + state->allocated);
+
+	spmc_shmem_free_list_del(state, obj);
+
+	/* Return the end of the block to the free lists if it is large enough */
+	blk_size = spmc_shmem_blk_size(obj);
+	if ((blk_size - obj_size) >= spmc_shmem_obj_size(0U)) {
+		next = spmc_shmem_blk_next(state, obj);
+		obj->blk_size = obj_size;
+
+		blk = (struct spmc_shmem_obj *)((uint8_t *)obj + obj_size);
+		blk->blk_size = blk_size - obj_size;
+		blk->prev_blk_size = obj_size;
+		if (next != NULL) {
+			next->prev_blk_size = blk->blk_size;
+		}
+		spmc_shmem_free_list_add(state, blk);
+	}
+
+	obj->next = NULL;
+	obj->prev = NULL;
+	obj->ranges = NULL;
 	obj->desc = (struct ffa_mtd) {0};
 	obj->desc_size = desc_size;
 	obj->desc_filled = 0;
 	obj->in_use = 0;
-	state->allocated += obj_size;
+	state->allocated += spmc_shmem_blk_size(obj);
 	return obj;
 }
 
+/**
+ * spmc_shmem_obj_index - Make an object reachable by its handle.
+ * @state:      Global state.
+ * @obj:        Object whose handle has been set.
+ */
+static void spmc_shmem_obj_index(struct spmc_shmem_obj_state *state,
+				 struct spmc_shmem_obj *obj)
+{
+	struct spmc_shmem_obj **bucket =
+		&state->handle_index[obj->desc.handle &
+				     (SPMC_SHMEM_HANDLE_BUCKETS - 1U)];
+
+	obj->next = *bucket;
+	*bucket = obj;
+}
+
+/**
+ * spmc_shmem_obj_remove_ranges - Remove the memory ranges of an object from
+ *                                the interval index.
+ * @state:      Global state.
+ * @obj:        Object whose ranges have been added to the index.
+ */
+static void spmc_shmem_obj_remove_ranges(struct spmc_shmem_obj_state *state,
+					 struct spmc_shmem_obj *obj)
+{
+	struct spmc_shmem_range *range =
+		(struct spmc_shmem_range *)&obj->ranges->desc;
+	size_t count = obj->ranges->desc_size / sizeof(*range);
+
+	for (size_t i = 0; i < count; i++) {
+		state->range_root = spmc_shmem_range_remove(state->range_root,
+							    &range[i]);
+	}
+}
+
 /**
  * spmc_shmem_obj_free - Free struct spmc_shmem_obj.
  * @state:      Global state.
  * @obj:        Object to free.
  *
- * Release memory used by @obj. Other objects may move, so on return all
- * pointers to struct spmc_shmem_obj object should be considered invalid, not
- * just @obj.
- *
- * The current implementation always compacts the remaining objects to simplify
- * the allocator and to avoid fragmentation.
+ * Remove @obj from the handle index and release the memory it uses, merging
+ * it with the neighbouring free blocks. Other objects are not moved.
  */
 
 static void spmc_shmem_obj_free(struct spmc_shmem_obj_state *state,
 				  struct spmc_shmem_obj *obj)
 {
-	size_t free_size = spmc_shmem_obj_size(obj->desc_size);
-	uint8_t *shift_dest = (uint8_t *)obj;
-	uint8_t *shift_src = shift_dest + free_size;
-	size_t shift_size = state->allocated - (shift_src - state->data);
+	struct spmc_shmem_obj **link =
+		&state->handle_index[obj->desc.handle &
+				     (SPMC_SHMEM_HANDLE_BUCKETS - 1U)];
+	struct spmc_shmem_obj *blk;
 
-	if (shift_size != 0U) {
-		memmove(shift_dest, shift_src, shift_size);
+	if (obj->ranges != NULL) {
+		spmc_shmem_obj_remove_ranges(state, obj);
+		spmc_shmem_obj_free(state, obj->ranges);
+		obj->ranges = NULL;
 	}
-	state->allocated -= free_size;
+
+	while (*link != NULL) {
+		if (*link == obj) {
+			*link = obj->next;
+			break;
+		}
+		link = &(*link)->next;
+	}
+
+	state->allocated -= spmc_shmem_blk_size(obj);
+
+	blk = spmc_shmem_blk_next(state, obj);
+	if ((blk != NULL) && spmc_shmem_blk_is_free(blk)) {
+		spmc_shmem_free_list_del(state, blk);
+		obj->blk_size += blk->blk_size;
+	}
+
+	blk = spmc_shmem_blk_prev(obj);
+	if ((blk != NULL) && spmc_shmem_blk_is_free(blk)) {
+		spmc_shmem_free_list_del(state, blk);
+		blk->blk_size += obj->blk_size;
+		obj = blk;
+	}
+
+	blk = spmc_shmem_blk_next(state, obj);
+	if (blk != NULL) {
+		blk->prev_blk_size = obj->blk_size;
+	}
+
+	spmc_shmem_free_list_add(state, obj);
 }
 
 /**
@@ -140,39 +598,14 @@ static void spmc_shmem_obj_free(struct spmc_shmem_obj_state *state,
 static struct spmc_shmem_obj *
 spmc_shmem_obj_lookup(struct spmc_shmem_obj_state *state, uint64_t handle)
 {
-	uint8_t *curr = state->data;
-
-	while (curr - state->data < state->allocated) {
-		struct spmc_shmem_obj *obj = (struct spmc_shmem_obj *)curr;
+	struct spmc_shmem_obj *obj;
 
+	obj = state->handle_index[handle & (SPMC_SHMEM_HANDLE_BUCKETS - 1U)];
+	while (obj != NULL) {
 		if (obj->desc.handle == handle) {
 			return obj;
 		}
-		curr += spmc_shmem_obj_size(obj->desc_size);
-	}
-	return NULL;
-}
-
-/**
- * spmc_shmem_obj_get_next - Get the next memory object from an offset.
- * @offset:     Offset used to track which objects have previously been
- *              returned.
- *
- * Return: the next struct spmc_shmem_obj_state object from the provided
- *	   offset.
- *	   %NULL, if there are no more objects.
- */
-static struct spmc_shmem_obj *
-spmc_shmem_obj_get_next(struct spmc_shmem_obj_state *state, size_t *offset)
-{
-	uint8_t *curr = state->data + *offset;
-
-	if (curr - state->data < state->allocated) {
-		struct spmc_shmem_obj *obj = (struct spmc_shmem_obj *)curr;
-
-		*offset += spmc_shmem_obj_size(obj->desc_size);
-
-		return obj;
+		obj = obj->next;
 	}
 	return NULL;
 }
@@ -309,61 +742,6 @@ bool spmc_shmem_obj_validate_id(struct spmc_shmem_obj *obj, uint16_t sp_id)
 	return found;
 }
 
-/*
- * Compare two memory regions to determine if any range overlaps with another
- * ongoing memory transaction.
- */
-static bool
-overlapping_memory_regions(struct ffa_comp_mrd *region1,
-			   struct ffa_comp_mrd *region2)
-{
-	uint64_t region1_start;
-	uint64_t region1_size;
-	uint64_t region1_end;
-	uint64_t region2_start;
-	uint64_t region2_size;
-	uint64_t region2_end;
-
-	assert(region1 != NULL);
-	assert(region2 != NULL);
-
-	if (region1 == region2) {
-		return true;
-	}
-
-	/*
-	 * Check each memory region in the request against existing
-	 * transactions.
-	 */
-	for (size_t i = 0; i < region1->address_range_count; i++) {
-
-		region1_start = region1->address_range_array[i].address;
-		region1_size =
-			region1->address_range_array[i].page_count *
-			PAGE_SIZE_4KB;
-		region1_end = region1_start + region1_size;
-
-		for (size_t j = 0; j < region2->address_range_count; j++) {
-
-			region2_start = region2->address_range_array[j].address;
-			region2_size =
-				region2->address_range_array[j].page_count *
-				PAGE_SIZE_4KB;
-			region2_end = region2_start + region2_size;
-
-			/* Check if regions are not overlapping. */
-			if (!((region2_end <= region1_start) ||
-			      (region1_end <= region2_start))) {
-				WARN("Overlapping mem regions 0x%lx-0x%lx & 0x%lx-0x%lx\n",
-				     region1_start, region1_end,
-				     region2_start, region2_end);
-				return true;
-			}
-		}
-	}
-	return false;
-}
-
 /*******************************************************************************
  * FF-A v1.0 Memory Descriptor Conversion Helpers.
  ******************************************************************************/
@@ -652,8 +1030,6 @@ spmc_shm_convert_mtd_to_v1_0(struct spmc_shmem_obj *out_obj,
  *                  descriptor.
  *
  * Return: 0 if conversion and population succeeded.
- * Note: This function invalidates the reference to @orig therefore
- * `spmc_shmem_obj_lookup` must be called if further usage is required.
  */
 static uint32_t
 spmc_populate_ffa_v1_0_descriptor(void *dst, struct spmc_shmem_obj *orig_obj,
@@ -689,11 +1065,7 @@ spmc_populate_ffa_v1_0_descriptor(void *dst, struct spmc_shmem_obj *orig_obj,
 		*copy_size = MIN(v1_0_obj->desc_size - offset, buf_size);
 		memcpy(dst, (uint8_t *) &v1_0_obj->desc + offset, *copy_size);
 
-		/*
-		 * We're finished with the v1.0 descriptor for now so free it.
-		 * Note that this will invalidate any references to the v1.1
-		 * descriptor.
-		 */
+		/* We're finished with the v1.0 descriptor for now so free it. */
 		spmc_shmem_obj_free(&spmc_shmem_obj_state, v1_0_obj);
 
 		return 0;
@@ -856,10 +1228,7 @@ static int spmc_shmem_check_obj(struct spmc_shmem_obj *obj,
 static int spmc_shmem_check_state_obj(struct spmc_shmem_obj *obj,
 				      uint32_t ffa_version)
 {
-	size_t obj_offset = 0;
-	struct spmc_shmem_obj *inflight_obj;
-
-	struct ffa_comp_mrd *other_mrd;
+	struct spmc_shmem_range *other;
 	struct ffa_comp_mrd *requested_mrd = spmc_shmem_obj_get_comp_mrd(obj,
 								  ffa_version);
 
@@ -867,29 +1236,68 @@ static int spmc_shmem_check_state_obj(struct spmc_shmem_obj *obj,
 		return -EINVAL;
 	}
 
-	inflight_obj = spmc_shmem_obj_get_next(&spmc_shmem_obj_state,
-					       &obj_offset);
-
-	while (inflight_obj != NULL) {
-		/*
-		 * Don't compare the transaction to itself or to partially
-		 * transmitted descriptors.
-		 */
-		if ((obj->desc.handle != inflight_obj->desc.handle) &&
-		    (obj->desc_size == obj->desc_filled)) {
-			other_mrd = spmc_shmem_obj_get_comp_mrd(inflight_obj,
-							  FFA_VERSION_COMPILED);
-			if (other_mrd == NULL) {
-				return -EINVAL;
-			}
-			if (overlapping_memory_regions(requested_mrd,
-						       other_mrd)) {
-				return -EINVAL;
-			}
+	/*
+	 * Check each memory region in the request against the ranges of the
+	 * complete transactions, which do not include this one.
+	 */
+	for (size_t i = 0; i < requested_mrd->address_range_count; i++) {
+		struct ffa_cons_mrd *cons = &requested_mrd->address_range_array[i];
+		uint64_t base = cons->address;
+		uint64_t end = base + ((uint64_t)cons->page_count *
+				       PAGE_SIZE_4KB);
+
+		other = spmc_shmem_range_find_overlap(
+				spmc_shmem_obj_state.range_root, base, end);
+		if (other != NULL) {
+			WARN("Overlapping mem regions 0x%lx-0x%lx & 0x%lx-0x%lx\n",
+			     base, end, other->base, other->end);
+			return -EINVAL;
 		}
+	}
+	return 0;
+}
+
+/**
+ * spmc_shmem_obj_add_ranges - Add the memory ranges of a complete transaction
+ *                             to the interval index.
+ * @state:      Global state.
+ * @obj:        Object containing a v1.1 ffa_memory_region_descriptor.
+ *
+ * Return: 0 on success, -EINVAL if the descriptor is invalid, -ENOMEM if there
+ *         is not enough space left in the datastore.
+ */
+static int spmc_shmem_obj_add_ranges(struct spmc_shmem_obj_state *state,
+				     struct spmc_shmem_obj *obj)
+{
+	struct spmc_shmem_range *range;
+	struct ffa_comp_mrd *mrd = spmc_shmem_obj_get_comp_mrd(obj,
+							FFA_VERSION_COMPILED);
+	size_t count;
 
-		inflight_obj = spmc_shmem_obj_get_next(&spmc_shmem_obj_state,
-						       &obj_offset);
+	if (mrd == NULL) {
+		return -EINVAL;
+	}
+
+	count = mrd->address_range_count;
+	if (count == 0U) {
+		/* Nothing to index */
+		return 0;
+	}
+
+	obj->ranges = spmc_shmem_obj_alloc(state, count * sizeof(*range));
+	if (obj->ranges == NULL) {
+		return -ENOMEM;
+	}
+
+	range = (struct spmc_shmem_range *)&obj->ranges->desc;
+	for (size_t i = 0; i < count; i++) {
+		struct ffa_cons_mrd *cons = &mrd->address_range_array[i];
+
+		range[i].base = cons->address;
+		range[i].end = cons->address +
+			       ((uint64_t)cons->page_count * PAGE_SIZE_4KB);
+		state->range_root = spmc_shmem_range_insert(state->range_root,
+							    &range[i]);
 	}
 	return 0;
 }
@@ -962,6 +1370,7 @@ static long spmc_ffa_fill_desc(struct mailbox *mbox,
 		/* First fragment, descriptor header has been copied */
 		obj->desc.handle = spmc_shmem_obj_state.next_handle++;
 		obj->desc.flags |= mtd_flag;
+		spmc_shmem_obj_index(&spmc_shmem_obj_state, obj);
 	}
 
 	obj->desc_filled += fragment_length;
@@ -1048,7 +1457,6 @@ static long spmc_ffa_fill_desc(struct mailbox *mbox,
 	 */
 	if (ffa_version == MAKE_FFA_VERSION(1, 0)) {
 		struct spmc_shmem_obj *v1_1_obj;
-		uint64_t mem_handle;
 
 		/* Calculate the size that the v1.1 descriptor will required. */
 		size_t v1_1_desc_size =
@@ -1081,17 +1489,20 @@ static long spmc_ffa_fill_desc(struct mailbox *mbox,
 
 		/*
 		 * We're finished with the v1.0 descriptor so free it
-		 * and continue our checks with the new v1.1 descriptor.
+		 * and continue our checks with the new v1.1 descriptor,
+		 * which takes its place in the handle index.
 		 */
-		mem_handle = obj->desc.handle;
 		spmc_shmem_obj_free(&spmc_shmem_obj_state, obj);
-		obj = spmc_shmem_obj_lookup(&spmc_shmem_obj_state, mem_handle);
-		if (obj == NULL) {
-			ERROR("%s: Failed to find converted descriptor.\n",
-			     __func__);
-			ret = FFA_ERROR_INVALID_PARAMETER;
-			return spmc_ffa_error_return(smc_handle, ret);
-		}
+		obj = v1_1_obj;
+		spmc_shmem_obj_index(&spmc_shmem_obj_state, obj);
+	}
+
+	/* Track the memory of the transaction to reject overlapping ones. */
+	ret = spmc_shmem_obj_add_ranges(&spmc_shmem_obj_state, obj);
+	if (ret != 0) {
+		ret = (ret == -ENOMEM) ? FFA_ERROR_NO_MEMORY :
+					 FFA_ERROR_INVALID_PARAMETER;
+		goto err_arg;
 	}
 
 	/* Allow for platform specific operations to be performed. */
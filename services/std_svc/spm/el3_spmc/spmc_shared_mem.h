@@ -31,12 +31,25 @@ struct ffa_mem_relinquish_descriptor {
 CASSERT(sizeof(struct ffa_mem_relinquish_descriptor) == 16,
 	assert_ffa_mem_relinquish_descriptor_size_mismatch);
 
+/* Number of free lists of datastore blocks, sorted by size class */
+#define SPMC_SHMEM_FREE_LISTS		U(16)
+
+/* Number of buckets of the handle index, must be a power of 2 */
+#define SPMC_SHMEM_HANDLE_BUCKETS	U(64)
+
+struct spmc_shmem_obj;
+struct spmc_shmem_range;
+
 /**
  * struct spmc_shmem_obj_state - Global state.
  * @data:           Backing store for spmc_shmem_obj objects.
  * @data_size:      The size allocated for the backing store.
  * @allocated:      Number of bytes allocated in @data.
  * @next_handle:    Handle used for next allocated object.
+ * @free_list:      Free blocks of @data, by size class.
+ * @handle_index:   Objects with a handle, hashed by handle.
+ * @range_root:     Root of the interval index of the memory ranges of the
+ *                  complete transactions.
  * @lock:           Lock protecting all state in this file.
  */
 struct spmc_shmem_obj_state {
@@ -44,10 +57,14 @@ struct spmc_shmem_obj_state {
 	size_t data_size;
 	size_t allocated;
 	uint64_t next_handle;
+	struct spmc_shmem_obj *free_list[SPMC_SHMEM_FREE_LISTS];
+	struct spmc_shmem_obj *handle_index[SPMC_SHMEM_HANDLE_BUCKETS];
+	struct spmc_shmem_range *range_root;
 	spinlock_t lock;
 };
 
 extern struct spmc_shmem_obj_state spmc_shmem_obj_state;
+void spmc_shmem_obj_state_init(struct spmc_shmem_obj_state *state);
 extern int plat_spmc_shmem_begin(struct ffa_mtd *desc);
 extern int plat_spmc_shmem_reclaim(struct ffa_mtd *desc);
 
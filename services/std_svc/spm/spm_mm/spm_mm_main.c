@@ -12,6 +12,7 @@
 #include <bl31/ehf.h>
 #include <common/debug.h>
 #include <common/runtime_svc.h>
+#include <lib/cassert.h>
 #include <lib/el3_runtime/context_mgmt.h>
 #include <lib/smccc.h>
 #include <lib/spinlock.h>
@@ -25,10 +26,18 @@
 #include "spm_common.h"
 #include "spm_mm_private.h"
 
+CASSERT(PLAT_SP_IMAGE_EC_COUNT <= PLATFORM_CORE_COUNT,
+	assert_sp_image_ec_count);
+
+/*******************************************************************************
+ * Secure Partition context information, one per execution context.
+ ******************************************************************************/
+static sp_context_t sp_ctx[PLAT_SP_IMAGE_EC_COUNT];
+
 /*******************************************************************************
- * Secure Partition context information.
+ * Execution context of the Secure Partition running on each core, if any.
  ******************************************************************************/
-static sp_context_t sp_ctx;
+static sp_context_t *sp_ctx_running[PLATFORM_CORE_COUNT];
 
 /*******************************************************************************
  * Set state of a Secure Partition context.
@@ -93,6 +102,7 @@ static uint64_t spm_sp_synchronous_entry(sp_context_t *ctx)
 	assert(ctx != NULL);
 
 	/* Assign the context of the SP to this CPU */
+	sp_ctx_running[plat_my_core_pos()] = ctx;
 	cm_set_context(&(ctx->cpu_ctx), SECURE);
 
 	/* Restore the context assigned above */
@@ -108,6 +118,16 @@ static uint64_t spm_sp_synchronous_entry(sp_context_t *ctx)
 
 	/* Save secure state */
 	cm_el1_sysregs_context_save(SECURE);
+	sp_ctx_running[plat_my_core_pos()] = NULL;
+
+#if CTX_LAZY_FPREGS
+	/*
+	 * SP runs to completion, drop its FP registers if it has used them, so
+	 * that the execution context can run on another CPU next. The non secure
+	 * world FP registers are restored on its next FP access.
+	 */
+	cm_fpregs_lazy_release(&(ctx->cpu_ctx));
+#endif
 
 	return rc;
 }
@@ -118,7 +138,9 @@ static uint64_t spm_sp_synchronous_entry(sp_context_t *ctx)
  ******************************************************************************/
 __dead2 static void spm_sp_synchronous_exit(uint64_t rc)
 {
-	sp_context_t *ctx = &sp_ctx;
+	sp_context_t *ctx = sp_ctx_running[plat_my_core_pos()];
+
+	assert(ctx != NULL);
 
 	/*
 	 * The SPM must have initiated the original request through a
@@ -135,19 +157,21 @@ __dead2 static void spm_sp_synchronous_exit(uint64_t rc)
  ******************************************************************************/
 static int32_t spm_init(void)
 {
-	uint64_t rc;
+	uint64_t rc = 0;
 	sp_context_t *ctx;
 
 	INFO("Secure Partition init...\n");
 
-	ctx = &sp_ctx;
+	for (unsigned int i = 0U; i < PLAT_SP_IMAGE_EC_COUNT; i++) {
+		ctx = &sp_ctx[i];
 
-	ctx->state = SP_STATE_RESET;
+		ctx->state = SP_STATE_RESET;
 
-	rc = spm_sp_synchronous_entry(ctx);
-	assert(rc == 0);
+		rc = spm_sp_synchronous_entry(ctx);
+		assert(rc == 0);
 
-	ctx->state = SP_STATE_IDLE;
+		ctx->state = SP_STATE_IDLE;
+	}
 
 	INFO("Secure Partition initialized.\n");
 
@@ -160,6 +184,7 @@ static int32_t spm_init(void)
 int32_t spm_mm_setup(void)
 {
 	sp_context_t *ctx;
+	int ret;
 
 	/* Disable MMU at EL1 (initialized by BL2) */
 	disable_mmu_icache_el1();
@@ -167,13 +192,22 @@ int32_t spm_mm_setup(void)
 	/* Initialize context of the SP */
 	INFO("Secure Partition context setup start...\n");
 
-	ctx = &sp_ctx;
+	ctx = &sp_ctx[0];
 
 	/* Assign translation tables context. */
 	ctx->xlat_ctx_handle = spm_get_sp_xlat_context();
 
 	spm_sp_setup(ctx);
 
+	/* The other execution contexts share the translation tables. */
+	for (unsigned int i = 1U; i < PLAT_SP_IMAGE_EC_COUNT; i++) {
+		ret = spm_sp_ec_setup(&sp_ctx[i], ctx, i);
+		if (ret != 0) {
+			/* spm_init() is not registered, so the SP never runs */
+			return ret;
+		}
+	}
+
 	/* Register init function for deferred init.  */
 	bl31_register_bl32_init(&spm_init);
 
@@ -183,14 +217,40 @@ int32_t spm_mm_setup(void)
 }
 
 /*******************************************************************************
- * Function to perform a call to a Secure Partition.
+ * Find an idle execution context of the Secure Partition and set it to busy.
+ * The search starts from a different context on each core so that concurrent
+ * requests are spread over the contexts. If all of them are busy, either wait
+ * until one becomes idle or return NULL.
  ******************************************************************************/
-uint64_t spm_mm_sp_call(uint32_t smc_fid, uint64_t x1, uint64_t x2, uint64_t x3)
+static sp_context_t *spm_sp_ec_acquire(bool wait)
+{
+	unsigned int start = plat_my_core_pos() % PLAT_SP_IMAGE_EC_COUNT;
+	sp_context_t *sp_ptr;
+
+	do {
+		for (unsigned int i = 0U; i < PLAT_SP_IMAGE_EC_COUNT; i++) {
+			sp_ptr = &sp_ctx[(start + i) % PLAT_SP_IMAGE_EC_COUNT];
+
+			if (sp_state_try_switch(sp_ptr, SP_STATE_IDLE,
+						SP_STATE_BUSY) == 0) {
+				return sp_ptr;
+			}
+		}
+	} while (wait);
+
+	return NULL;
+}
+
+/*******************************************************************************
+ * Function to perform a call to a busy execution context of a Secure
+ * Partition, which is set back to idle on return.
+ ******************************************************************************/
+static uint64_t spm_sp_ec_call(sp_context_t *sp_ptr, uint32_t smc_fid,
+			       uint64_t x1, uint64_t x2, uint64_t x3)
 {
 	uint64_t rc;
-	sp_context_t *sp_ptr = &sp_ctx;
 
-#if CTX_INCLUDE_FPREGS
+#if CTX_INCLUDE_FPREGS && !CTX_LAZY_FPREGS
 	/*
 	 * SP runs to completion, no need to restore FP registers of secure context.
 	 * Save FP registers only for non secure context.
@@ -198,9 +258,6 @@ uint64_t spm_mm_sp_call(uint32_t smc_fid, uint64_t x1, uint64_t x2, uint64_t x3)
 	fpregs_context_save(get_fpregs_ctx(cm_get_context(NON_SECURE)));
 #endif
 
-	/* Wait until the Secure Partition is idle and set it to busy. */
-	sp_state_wait_switch(sp_ptr, SP_STATE_IDLE, SP_STATE_BUSY);
-
 	/* Set values for registers on SP entry */
 	cpu_context_t *cpu_ctx = &(sp_ptr->cpu_ctx);
 
@@ -216,7 +273,7 @@ uint64_t spm_mm_sp_call(uint32_t smc_fid, uint64_t x1, uint64_t x2, uint64_t x3)
 	assert(sp_ptr->state == SP_STATE_BUSY);
 	sp_state_set(sp_ptr, SP_STATE_IDLE);
 
-#if CTX_INCLUDE_FPREGS
+#if CTX_INCLUDE_FPREGS && !CTX_LAZY_FPREGS
 	/*
 	 * SP runs to completion, no need to save FP registers of secure context.
 	 * Restore only non secure world FP registers.
@@ -227,6 +284,17 @@ uint64_t spm_mm_sp_call(uint32_t smc_fid, uint64_t x1, uint64_t x2, uint64_t x3)
 	return rc;
 }
 
+/*******************************************************************************
+ * Function to perform a call to a Secure Partition.
+ ******************************************************************************/
+uint64_t spm_mm_sp_call(uint32_t smc_fid, uint64_t x1, uint64_t x2, uint64_t x3)
+{
+	/* Wait until an execution context is idle and set it to busy. */
+	sp_context_t *sp_ptr = spm_sp_ec_acquire(true);
+
+	return spm_sp_ec_call(sp_ptr, smc_fid, x1, x2, x3);
+}
+
 /*******************************************************************************
  * MM_COMMUNICATE handler
  ******************************************************************************/
@@ -235,6 +303,7 @@ static uint64_t mm_communicate(uint32_t smc_fid, uint64_t mm_cookie,
 			       uint64_t comm_size_address, void *handle)
 {
 	uint64_t rc;
+	sp_context_t *sp_ptr;
 
 	/* Cookie. Reserved for future use. It must be zero. */
 	if (mm_cookie != 0U) {
@@ -251,10 +320,21 @@ static uint64_t mm_communicate(uint32_t smc_fid, uint64_t mm_cookie,
 		VERBOSE("MM_COMMUNICATE: comm_size_address is not 0 as recommended.\n");
 	}
 
+	/*
+	 * Claim an idle execution context of the secure partition. If all of
+	 * them are busy, let the caller retry instead of spinning in EL3 when
+	 * SPM_MM_BUSY_RETURN is enabled.
+	 */
+	sp_ptr = spm_sp_ec_acquire(SPM_MM_BUSY_RETURN == 0);
+	if (sp_ptr == NULL) {
+		SMC_RET1(handle, SPM_MM_BUSY);
+	}
+
 	/*
 	 * The current secure partition design mandates
 	 * - at any point, only a single core can be
-	 *   executing in the secure partiton.
+	 *   executing in an execution context of the
+	 *   secure partiton.
 	 * - a core cannot be preempted by an interrupt
 	 *   while executing in secure partition.
 	 * Raise the running priority of the core to the
@@ -267,8 +347,8 @@ static uint64_t mm_communicate(uint32_t smc_fid, uint64_t mm_cookie,
 	/* Save the Normal world context */
 	cm_el1_sysregs_context_save(NON_SECURE);
 
-	rc = spm_mm_sp_call(smc_fid, comm_buffer_address, comm_size_address,
-			    plat_my_core_pos());
+	rc = spm_sp_ec_call(sp_ptr, smc_fid, comm_buffer_address,
+			    comm_size_address, plat_my_core_pos());
 
 	/* Restore non-secure state */
 	cm_el1_sysregs_context_restore(NON_SECURE);
@@ -296,6 +376,7 @@ uint64_t spm_mm_smc_handler(uint32_t smc_fid,
 			 uint64_t flags)
 {
 	unsigned int ns;
+	sp_context_t *sp_ptr;
 
 	/* Determine which security state this SMC originated from */
 	ns = is_caller_non_secure(flags);
@@ -306,6 +387,9 @@ uint64_t spm_mm_smc_handler(uint32_t smc_fid,
 
 		assert(handle == cm_get_context(SECURE));
 
+		sp_ptr = sp_ctx_running[plat_my_core_pos()];
+		assert(sp_ptr != NULL);
+
 		/* Make next ERET jump to S-EL0 instead of S-EL1. */
 		cm_set_elr_spsr_el3(SECURE, read_elr_el1(), read_spsr_el1());
 
@@ -320,24 +404,24 @@ uint64_t spm_mm_smc_handler(uint32_t smc_fid,
 		case MM_SP_MEMORY_ATTRIBUTES_GET_AARCH64:
 			INFO("Received MM_SP_MEMORY_ATTRIBUTES_GET_AARCH64 SMC\n");
 
-			if (sp_ctx.state != SP_STATE_RESET) {
+			if (sp_ptr->state != SP_STATE_RESET) {
 				WARN("MM_SP_MEMORY_ATTRIBUTES_GET_AARCH64 is available at boot time only\n");
 				SMC_RET1(handle, SPM_MM_NOT_SUPPORTED);
 			}
 			SMC_RET1(handle,
 				 spm_memory_attributes_get_smc_handler(
-					 &sp_ctx, x1));
+					 sp_ptr, x1));
 
 		case MM_SP_MEMORY_ATTRIBUTES_SET_AARCH64:
 			INFO("Received MM_SP_MEMORY_ATTRIBUTES_SET_AARCH64 SMC\n");
 
-			if (sp_ctx.state != SP_STATE_RESET) {
+			if (sp_ptr->state != SP_STATE_RESET) {
 				WARN("MM_SP_MEMORY_ATTRIBUTES_SET_AARCH64 is available at boot time only\n");
 				SMC_RET1(handle, SPM_MM_NOT_SUPPORTED);
 			}
 			SMC_RET1(handle,
 				 spm_memory_attributes_set_smc_handler(
-					&sp_ctx, x1, x2, x3));
+					sp_ptr, x1, x2, x3));
 		default:
 			break;
 		}
@@ -37,6 +37,16 @@
 #include <lib/spinlock.h>
 #include <lib/xlat_tables/xlat_tables_v2.h>
 
+#include <platform_def.h>
+
+/*
+ * Number of execution contexts of the Secure Partition. Each of them has a
+ * stack of its own and can handle a request concurrently with the others.
+ */
+#ifndef PLAT_SP_IMAGE_EC_COUNT
+#define PLAT_SP_IMAGE_EC_COUNT	U(1)
+#endif
+
 typedef enum sp_state {
 	SP_STATE_RESET = 0,
 	SP_STATE_IDLE,
@@ -54,6 +64,8 @@ typedef struct sp_context {
 
 
 void spm_sp_setup(sp_context_t *sp_ctx);
+int spm_sp_ec_setup(sp_context_t *ec_ctx, const sp_context_t *sp_ctx,
+		    unsigned int ec_index);
 
 xlat_ctx_t *spm_get_sp_xlat_context(void);
 
@@ -6,6 +6,7 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <string.h>
 
 #include <arch.h>
@@ -40,6 +41,10 @@ void spm_sp_setup(sp_context_t *sp_ctx)
 	entry_point_info_t ep_info = {0};
 
 	SET_PARAM_HEAD(&ep_info, PARAM_EP, VERSION_1, SECURE | EP_ST_ENABLE);
+#if CTX_LAZY_FPREGS
+	/* The FP registers are not saved around calls to the SP in this case */
+	EP_SET_FPREGS_LAZY(ep_info.h.attr, EP_FPREGS_LAZY);
+#endif
 
 	/* Setup entrypoint and SPSR */
 	ep_info.pc = sp_boot_info->sp_image_base;
@@ -57,7 +62,10 @@ void spm_sp_setup(sp_context_t *sp_ctx)
 	 *
 	 * X3: cookie value (Implementation Defined)
 	 *
-	 * X4 to X7 = 0
+	 * X4: Index of the execution context, 0 for this one. The other
+	 *     execution contexts are set up by spm_sp_ec_setup().
+	 *
+	 * X5 to X7 = 0
 	 */
 	ep_info.args.arg0 = sp_boot_info->sp_shared_buf_base;
 	ep_info.args.arg1 = sp_boot_info->sp_shared_buf_size;
@@ -258,3 +266,35 @@ void spm_sp_setup(sp_context_t *sp_ctx)
 			sp_mp_info[index].flags |= MP_INFO_FLAG_PRIMARY_CPU;
 	}
 }
+
+/*
+ * Setup an additional execution context of the Secure Partition from its first
+ * execution context, which must not have been run yet. Return -EINVAL if the
+ * boot info of the Secure Partition has no stack for it.
+ */
+int spm_sp_ec_setup(sp_context_t *ec_ctx, const sp_context_t *sp_ctx,
+		    unsigned int ec_index)
+{
+	cpu_context_t *ctx = &(ec_ctx->cpu_ctx);
+	const spm_mm_boot_info_t *sp_boot_info =
+			plat_get_secure_partition_boot_info(NULL);
+
+	if (ec_index >= sp_boot_info->num_cpus) {
+		ERROR("Secure Partition has %u stacks for %u execution contexts\n",
+		      sp_boot_info->num_cpus, PLAT_SP_IMAGE_EC_COUNT);
+		return -EINVAL;
+	}
+
+	ec_ctx->xlat_ctx_handle = sp_ctx->xlat_ctx_handle;
+	memcpy(ctx, &(sp_ctx->cpu_ctx), sizeof(*ctx));
+
+	/* SP_EL0: Each execution context runs on a stack of its own. */
+	write_ctx_reg(get_gpregs_ctx(ctx), CTX_GPREG_SP_EL0,
+		      sp_boot_info->sp_stack_base +
+		      ((ec_index + 1U) * sp_boot_info->sp_pcpu_stack_size));
+
+	/* X4: Index of the execution context. */
+	write_ctx_reg(get_gpregs_ctx(ctx), CTX_GPREG_X4, ec_index);
+
+	return 0;
+}
@@ -20,6 +20,8 @@
 #include <lib/el3_runtime/context_mgmt.h>
 #include <lib/fconf/fconf.h>
 #include <lib/fconf/fconf_dyn_cfg_getter.h>
+#include <lib/pmf/pmf.h>
+#include <lib/runtime_instr.h>
 #include <lib/smccc.h>
 #include <lib/spinlock.h>
 #include <lib/utils.h>
@@ -560,27 +562,52 @@ uint64_t spmd_smc_switch_state(uint32_t smc_fid,
 	unsigned int secure_state_in = (secure_origin) ? SECURE : NON_SECURE;
 	unsigned int secure_state_out = (!secure_origin) ? SECURE : NON_SECURE;
 
-	/* Save incoming security state */
+#if ENABLE_RUNTIME_INSTRUMENTATION
+	if (secure_state_in == NON_SECURE) {
+		PMF_CAPTURE_TIMESTAMP(rt_instr_svc, RT_INSTR_ENTER_FFA,
+				      PMF_NO_CACHE_MAINT);
+	}
+#endif
+
 #if SPMD_SPM_AT_SEL2
+	/* Save incoming security state */
 	if (secure_state_in == NON_SECURE) {
 		cm_el1_sysregs_context_save(secure_state_in);
 	}
-	cm_el2_sysregs_context_save(secure_state_in);
+
+#if SPMD_LAZY_EL2_CTX
+	/*
+	 * Switch the EL2 context, only writing the registers whose value
+	 * differs between both states.
+	 */
+	cm_el2_sysregs_context_switch(secure_state_in, secure_state_out);
 #else
-	cm_el1_sysregs_context_save(secure_state_in);
+	cm_el2_sysregs_context_save(secure_state_in);
 #endif
 
 	/* Restore outgoing security state */
-#if SPMD_SPM_AT_SEL2
 	if (secure_state_out == NON_SECURE) {
 		cm_el1_sysregs_context_restore(secure_state_out);
 	}
+#if !SPMD_LAZY_EL2_CTX
 	cm_el2_sysregs_context_restore(secure_state_out);
+#endif
 #else
+	/* Save incoming security state */
+	cm_el1_sysregs_context_save(secure_state_in);
+
+	/* Restore outgoing security state */
 	cm_el1_sysregs_context_restore(secure_state_out);
 #endif
 	cm_set_next_eret_context(secure_state_out);
 
+#if ENABLE_RUNTIME_INSTRUMENTATION
+	if (secure_state_out == NON_SECURE) {
+		PMF_CAPTURE_TIMESTAMP(rt_instr_svc, RT_INSTR_EXIT_FFA,
+				      PMF_NO_CACHE_MAINT);
+	}
+#endif
+
 #if SPMD_SPM_AT_SEL2
 	/*
 	 * If SPMC is at SEL2, save additional registers x8-x17, which may
@@ -89,10 +89,9 @@ static int32_t std_svc_setup(void)
 }
 
 /*
- * Top-level Standard Service SMC handler. This handler will in turn dispatch
- * calls to PSCI SMC handler
+ * Dispatch a PSCI call to the PSCI SMC handler and return its return value
  */
-static uintptr_t std_svc_smc_handler(uint32_t smc_fid,
+static uintptr_t std_svc_psci_call(uint32_t smc_fid,
 			     u_register_t x1,
 			     u_register_t x2,
 			     u_register_t x3,
@@ -101,44 +100,55 @@ static uintptr_t std_svc_smc_handler(uint32_t smc_fid,
 			     void *handle,
 			     u_register_t flags)
 {
-	if (((smc_fid >> FUNCID_CC_SHIFT) & FUNCID_CC_MASK) == SMC_32) {
-		/* 32-bit SMC function, clear top parameter bits */
+	uint64_t ret;
 
-		x1 &= UINT32_MAX;
-		x2 &= UINT32_MAX;
-		x3 &= UINT32_MAX;
-		x4 &= UINT32_MAX;
-	}
+#if ENABLE_RUNTIME_INSTRUMENTATION
 
 	/*
-	 * Dispatch PSCI calls to PSCI SMC handler and return its return
-	 * value
+	 * Flush cache line so that even if CPU power down happens
+	 * the timestamp update is reflected in memory.
 	 */
-	if (is_psci_fid(smc_fid)) {
-		uint64_t ret;
-
-#if ENABLE_RUNTIME_INSTRUMENTATION
-
-		/*
-		 * Flush cache line so that even if CPU power down happens
-		 * the timestamp update is reflected in memory.
-		 */
-		PMF_WRITE_TIMESTAMP(rt_instr_svc,
-		    RT_INSTR_ENTER_PSCI,
-		    PMF_CACHE_MAINT,
-		    get_cpu_data(cpu_data_pmf_ts[CPU_DATA_PMF_TS0_IDX]));
+	PMF_WRITE_TIMESTAMP(rt_instr_svc,
+	    RT_INSTR_ENTER_PSCI,
+	    PMF_CACHE_MAINT,
+	    get_cpu_data(cpu_data_pmf_ts[CPU_DATA_PMF_TS0_IDX]));
 #endif
 
-		ret = psci_smc_handler(smc_fid, x1, x2, x3, x4,
-		    cookie, handle, flags);
+	ret = psci_smc_handler(smc_fid, x1, x2, x3, x4,
+	    cookie, handle, flags);
 
 #if ENABLE_RUNTIME_INSTRUMENTATION
-		PMF_CAPTURE_TIMESTAMP(rt_instr_svc,
-		    RT_INSTR_EXIT_PSCI,
-		    PMF_NO_CACHE_MAINT);
+	PMF_CAPTURE_TIMESTAMP(rt_instr_svc,
+	    RT_INSTR_EXIT_PSCI,
+	    PMF_NO_CACHE_MAINT);
 #endif
 
-		SMC_RET1(handle, ret);
+	SMC_RET1(handle, ret);
+}
+
+/*
+ * Top-level Standard Service SMC handler. This handler will in turn dispatch
+ * calls to PSCI SMC handler
+ */
+static uintptr_t std_svc_smc_handler(uint32_t smc_fid,
+			     u_register_t x1,
+			     u_register_t x2,
+			     u_register_t x3,
+			     u_register_t x4,
+			     void *cookie,
+			     void *handle,
+			     u_register_t flags)
+{
+	/* 32-bit SMC function, clear top parameter bits */
+	SMC32_CLEAR_PARAMS_TOP_BITS(smc_fid, x1, x2, x3, x4);
+
+	/*
+	 * Dispatch PSCI calls to PSCI SMC handler and return its return
+	 * value
+	 */
+	if (is_psci_fid(smc_fid)) {
+		return std_svc_psci_call(smc_fid, x1, x2, x3, x4, cookie,
+					 handle, flags);
 	}
 
 #if SPM_MM
@@ -236,3 +246,64 @@ DECLARE_RT_SVC(
 		std_svc_setup,
 		std_svc_smc_handler
 );
+
+#if RT_SVC_FID_TABLE
+/*
+ * Handlers for the hottest Standard Service calls, which BL31 dispatches
+ * through the function ID table without going through std_svc_smc_handler().
+ * They must clear the top parameter bits of 32-bit SMC functions themselves.
+ */
+static uintptr_t std_svc_psci_fast_handler(uint32_t smc_fid,
+			     u_register_t x1,
+			     u_register_t x2,
+			     u_register_t x3,
+			     u_register_t x4,
+			     void *cookie,
+			     void *handle,
+			     u_register_t flags)
+{
+	SMC32_CLEAR_PARAMS_TOP_BITS(smc_fid, x1, x2, x3, x4);
+
+	return std_svc_psci_call(smc_fid, x1, x2, x3, x4, cookie, handle,
+				 flags);
+}
+
+DECLARE_RT_SVC_FIDS(psci_cpu_suspend32, PSCI_CPU_SUSPEND_AARCH32,
+		    PSCI_CPU_SUSPEND_AARCH32, std_svc_psci_fast_handler);
+DECLARE_RT_SVC_FIDS(psci_cpu_suspend64, PSCI_CPU_SUSPEND_AARCH64,
+		    PSCI_CPU_SUSPEND_AARCH64, std_svc_psci_fast_handler);
+
+#if defined(SPD_spmd)
+static uintptr_t std_svc_ffa_fast_handler(uint32_t smc_fid,
+			     u_register_t x1,
+			     u_register_t x2,
+			     u_register_t x3,
+			     u_register_t x4,
+			     void *cookie,
+			     void *handle,
+			     u_register_t flags)
+{
+	SMC32_CLEAR_PARAMS_TOP_BITS(smc_fid, x1, x2, x3, x4);
+
+	return spmd_ffa_smc_handler(smc_fid, x1, x2, x3, x4, cookie, handle,
+				    flags);
+}
+
+/* FFA_MSG_SEND_DIRECT_REQ and FFA_MSG_SEND_DIRECT_RESP are consecutive */
+DECLARE_RT_SVC_FIDS(ffa_direct_msg32, FFA_MSG_SEND_DIRECT_REQ_SMC32,
+		    FFA_MSG_SEND_DIRECT_RESP_SMC32, std_svc_ffa_fast_handler);
+DECLARE_RT_SVC_FIDS(ffa_direct_msg64, FFA_MSG_SEND_DIRECT_REQ_SMC64,
+		    FFA_MSG_SEND_DIRECT_RESP_SMC64, std_svc_ffa_fast_handler);
+#endif /* SPD_spmd */
+
+#if ENABLE_RME
+/* The RMI and RMM-EL3 interfaces only have 64-bit SMC functions */
+DECLARE_RT_SVC_FIDS(rmi, SMC64_RMI_FID(U(0)),
+		    SMC64_RMI_FID(RMI_FNUM_MAX_VALUE - RMI_FNUM_MIN_VALUE),
+		    rmmd_rmi_handler);
+DECLARE_RT_SVC_FIDS(rmm_gtsi, RMM_GTSI_DELEGATE, RMM_GTSI_UNDELEGATE,
+		    rmmd_rmm_el3_handler);
+DECLARE_RT_SVC_FIDS(rmm_gtsi_range, RMM_GTSI_DELEGATE_RANGE,
+		    RMM_GTSI_UNDELEGATE_RANGE, rmmd_rmm_el3_handler);
+#endif /* ENABLE_RME */
+#endif /* RT_SVC_FID_TABLE */
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023, Arm Limited and Contributors. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+"""Decode the records drained from the BL31 EL3 trace rings.
+
+The input files hold el3_trace_record_t structures, as copied by the
+EL3_TRACE_SMC_64 DRAIN command to the shared buffer, for one or more CPUs. The
+records of all the files are merged and printed in timestamp order.
+"""
+
+import argparse
+import struct
+import sys
+
+# struct el3_trace_record, see include/lib/el3_trace.h
+RECORD = struct.Struct('<QQII3Q')
+
+SECURITY_STATES = {0x0: 'secure', 0x1: 'non-secure', 0x21: 'realm'}
+GPIS = {0x8: 'secure', 0x9: 'non-secure', 0xa: 'root', 0xb: 'realm'}
+INTR_TYPES = {0: 'S-EL1', 1: 'EL3', 2: 'NS'}
+
+
+def world_switch(args):
+    return 'to %s, context 0x%x' % (
+        SECURITY_STATES.get(args[0], args[0]), args[1])
+
+
+def gpt(direction):
+    def decode(args):
+        return '0x%x-0x%x %s %s' % (args[0], args[0] + args[1] - 1,
+                                    direction, GPIS.get(args[2], args[2]))
+    return decode
+
+
+def intr(args):
+    return '%s interrupt from %s, ELR_EL3 0x%x' % (
+        INTR_TYPES.get(args[0], args[0]),
+        'non-secure' if (args[1] & 1) else 'secure', args[2])
+
+
+# Event ID: (name, argument decoder)
+EVENTS = {
+    1: ('WORLD_SWITCH', world_switch),
+    2: ('GPT_DELEGATE', gpt('to')),
+    3: ('GPT_UNDELEGATE', gpt('from')),
+    4: ('PSCI_CPU_ON', lambda a: 'MPIDR 0x%x, entry 0x%x' % (a[0], a[1])),
+    5: ('PSCI_CPU_OFF', lambda a: 'level %d' % a[0]),
+    6: ('PSCI_CPU_SUSPEND', lambda a: 'level %d%s' % (
+        a[0], ', power down' if a[1] else '')),
+    7: ('PSCI_WAKEUP', lambda a: 'level %d' % a[0]),
+    8: ('INTR', intr),
+}
+
+
+def read_records(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) % RECORD.size:
+        sys.exit('%s: size is not a multiple of %d bytes' % (path, RECORD.size))
+    return [RECORD.unpack_from(data, off)
+            for off in range(0, len(data), RECORD.size)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('files', nargs='+', help='drained trace records')
+    parser.add_argument('--freq', type=int, default=0,
+                        help='generic counter frequency in Hz, to print '
+                        'times in microseconds instead of counter ticks')
+    opts = parser.parse_args()
+
+    records = []
+    for path in opts.files:
+        records += read_records(path)
+    records.sort(key=lambda r: (r[1], r[3], r[0]))
+    if not records:
+        return
+
+    start = records[0][1]
+    for seq, ts, event, cpu, *args in records:
+        if opts.freq:
+            time = '%14.3f' % ((ts - start) * 1e6 / opts.freq)
+        else:
+            time = '%14d' % (ts - start)
+        name, decode = EVENTS.get(event, ('EVENT_%d' % event, None))
+        if decode is not None:
+            desc = decode(args)
+        else:
+            desc = ' '.join('0x%x' % a for a in args)
+        print('%s cpu%-3d #%-8d %-18s %s' % (time, cpu, seq, name, desc))
+
+
+if __name__ == '__main__':
+    main()
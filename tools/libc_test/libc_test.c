@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2023, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host test of the AArch64 assembly memcpy(), memmove() and memcmp() of the
+ * firmware libc. Every combination of source and destination alignment and of
+ * length up to a few cache lines is checked against a byte-wise reference,
+ * including the bytes surrounding the destination, then the throughput of the
+ * routines is compared with that of the reference.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Routines under test, renamed when lib/libc/aarch64 is built for the host */
+void *tf_memcpy(void *dst, const void *src, size_t len);
+void *tf_memmove(void *dst, const void *src, size_t len);
+int tf_memcmp(const void *s1, const void *s2, size_t len);
+
+#define MAX_ALIGN	16U
+#define MAX_LEN		(4U * 64U)
+#define GUARD		64U
+#define BUF_SIZE	(GUARD + MAX_ALIGN + MAX_LEN + GUARD)
+#define MAX_OVERLAP	(MAX_LEN + MAX_ALIGN)
+
+static unsigned int errors;
+
+/* Byte-wise references, as in the generic C libc */
+static void *ref_memcpy(void *dst, const void *src, size_t len)
+{
+	const char *s = src;
+	char *d = dst;
+
+	while (len-- != 0U) {
+		*d++ = *s++;
+	}
+
+	return dst;
+}
+
+static void *ref_memmove(void *dst, const void *src, size_t len)
+{
+	const char *s = src;
+	char *d = dst;
+
+	if ((d > s) && (d < (s + len))) {
+		while (len-- != 0U) {
+			d[len] = s[len];
+		}
+		return dst;
+	}
+
+	return ref_memcpy(dst, src, len);
+}
+
+static int ref_memcmp(const void *s1, const void *s2, size_t len)
+{
+	const unsigned char *p1 = s1;
+	const unsigned char *p2 = s2;
+
+	for (; len != 0U; len--, p1++, p2++) {
+		if (*p1 != *p2) {
+			return *p1 - *p2;
+		}
+	}
+
+	return 0;
+}
+
+static void fill(unsigned char *buf, size_t len, unsigned int seed)
+{
+	for (size_t i = 0U; i < len; i++) {
+		buf[i] = (unsigned char)((i * 131U) + seed);
+	}
+}
+
+static void report(const char *name, unsigned int dst_off,
+		   unsigned int src_off, size_t len, const char *what)
+{
+	if (errors++ < 20U) {
+		printf("%s(dst+%u, src+%u, %zu): %s\n", name, dst_off, src_off,
+		       len, what);
+	}
+}
+
+static void test_memcpy(void)
+{
+	static unsigned char src[BUF_SIZE];
+	static unsigned char dst[BUF_SIZE];
+	static unsigned char exp[BUF_SIZE];
+
+	fill(src, sizeof(src), 7U);
+
+	for (unsigned int src_off = 0U; src_off < MAX_ALIGN; src_off++) {
+		for (unsigned int dst_off = 0U; dst_off < MAX_ALIGN; dst_off++) {
+			for (size_t len = 0U; len <= MAX_LEN; len++) {
+				unsigned char *d = dst + GUARD + dst_off;
+				unsigned char *s = src + GUARD + src_off;
+
+				memset(dst, 0xA5, sizeof(dst));
+				memset(exp, 0xA5, sizeof(exp));
+				ref_memcpy(exp + GUARD + dst_off, s, len);
+
+				if (tf_memcpy(d, s, len) != d) {
+					report("memcpy", dst_off, src_off, len,
+					       "bad return value");
+				}
+				if (memcmp(dst, exp, sizeof(dst)) != 0) {
+					report("memcpy", dst_off, src_off, len,
+					       "bad data");
+				}
+			}
+		}
+	}
+}
+
+static void test_memmove(void)
+{
+	static unsigned char buf[MAX_OVERLAP + BUF_SIZE + MAX_OVERLAP];
+	static unsigned char exp[MAX_OVERLAP + BUF_SIZE + MAX_OVERLAP];
+	unsigned char *base = buf + MAX_OVERLAP;
+
+	/* Every distance between 'dst' and 'src', in both directions */
+	for (unsigned int src_off = 0U; src_off < MAX_ALIGN; src_off++) {
+		for (int delta = -(int)MAX_OVERLAP; delta <= (int)MAX_OVERLAP;
+		     delta++) {
+			for (size_t len = 0U; len <= MAX_LEN; len += 7U) {
+				unsigned char *s = base + GUARD + src_off;
+				unsigned char *d = s + delta;
+				size_t d_pos = (size_t)(d - buf);
+
+				fill(buf, sizeof(buf), 3U);
+				fill(exp, sizeof(exp), 3U);
+				ref_memmove(exp + d_pos, exp + (s - buf), len);
+
+				if (tf_memmove(d, s, len) != d) {
+					report("memmove", (unsigned int)d_pos,
+					       src_off, len, "bad return value");
+				}
+				if (memcmp(buf, exp, sizeof(buf)) != 0) {
+					report("memmove", (unsigned int)d_pos,
+					       src_off, len, "bad data");
+				}
+			}
+		}
+	}
+}
+
+static int sign(int val)
+{
+	return (val > 0) - (val < 0);
+}
+
+static void check_memcmp(const unsigned char *s1, const unsigned char *s2,
+			 unsigned int off1, unsigned int off2, size_t len)
+{
+	if (sign(tf_memcmp(s1, s2, len)) != sign(ref_memcmp(s1, s2, len))) {
+		report("memcmp", off1, off2, len, "bad result");
+	}
+}
+
+static void test_memcmp(void)
+{
+	static unsigned char buf1[BUF_SIZE];
+	static unsigned char buf2[BUF_SIZE];
+
+	for (unsigned int off1 = 0U; off1 < MAX_ALIGN; off1++) {
+		for (unsigned int off2 = 0U; off2 < MAX_ALIGN; off2++) {
+			unsigned char *s1 = buf1 + GUARD + off1;
+			unsigned char *s2 = buf2 + GUARD + off2;
+
+			fill(buf1, sizeof(buf1), 0U);
+			memset(buf2, 0x5A, sizeof(buf2));
+
+			for (size_t len = 0U; len <= MAX_LEN; len++) {
+				memcpy(s2, s1, len);
+				check_memcmp(s1, s2, off1, off2, len);
+
+				/*
+				 * A difference at each position, both ways and
+				 * with the top bit set on one side only, to
+				 * catch signed byte compares.
+				 */
+				for (size_t pos = 0U; pos < len; pos++) {
+					unsigned char byte = s2[pos];
+
+					s2[pos] = s1[pos] ^ 0x80U;
+					check_memcmp(s1, s2, off1, off2, len);
+					s2[pos] = s1[pos] + 1U;
+					check_memcmp(s1, s2, off1, off2, len);
+					s2[pos] = byte;
+				}
+			}
+		}
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+typedef void *(*copy_fn_t)(void *dst, const void *src, size_t len);
+typedef int (*cmp_fn_t)(const void *s1, const void *s2, size_t len);
+
+/* Return the throughput in MB/s of a copy or compare routine */
+static double bench(copy_fn_t copy, cmp_fn_t cmp, unsigned char *dst,
+		    const unsigned char *src, size_t len)
+{
+	size_t iters = (64U << 20) / len;
+	volatile int res = 0;
+	double start = now();
+
+	for (size_t i = 0U; i < iters; i++) {
+		if (copy != NULL) {
+			copy(dst, src, len);
+		} else {
+			res += cmp(dst, src, len);
+		}
+	}
+
+	(void)res;
+	return ((double)iters * (double)len) / ((now() - start) * 1e6);
+}
+
+static void bench_all(void)
+{
+	static const size_t sizes[] = { 16U, 64U, 256U, 4096U, 65536U };
+	size_t size = (64U << 10) + 64U;
+	unsigned char *src = malloc(size);
+	unsigned char *dst = malloc(size);
+	unsigned char *cmp = malloc(size);
+
+	if ((src == NULL) || (dst == NULL) || (cmp == NULL)) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+	fill(src, size, 1U);
+	memcpy(cmp, src, size);
+
+	printf("\n%-8s %6s %5s %10s %10s\n", "routine", "size", "align",
+	       "MB/s", "ref MB/s");
+
+	for (unsigned int i = 0U; i < (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		for (unsigned int src_off = 0U; src_off < 2U; src_off++) {
+			size_t len = sizes[i];
+			const unsigned char *s = src + src_off;
+
+			printf("%-8s %6zu %5s %10.0f %10.0f\n", "memcpy", len,
+			       (src_off == 0U) ? "yes" : "no",
+			       bench(tf_memcpy, NULL, dst, s, len),
+			       bench(ref_memcpy, NULL, dst, s, len));
+			printf("%-8s %6zu %5s %10.0f %10.0f\n", "memmove", len,
+			       (src_off == 0U) ? "yes" : "no",
+			       bench(tf_memmove, NULL, dst, s, len),
+			       bench(ref_memmove, NULL, dst, s, len));
+			printf("%-8s %6zu %5s %10.0f %10.0f\n", "memcmp", len,
+			       (src_off == 0U) ? "yes" : "no",
+			       bench(NULL, tf_memcmp, cmp + src_off, s, len),
+			       bench(NULL, ref_memcmp, cmp + src_off, s, len));
+		}
+	}
+
+	free(src);
+	free(dst);
+	free(cmp);
+}
+
+int main(int argc, char *argv[])
+{
+	test_memcpy();
+	test_memmove();
+	test_memcmp();
+
+	if (errors != 0U) {
+		printf("FAILED: %u errors\n", errors);
+		return 1;
+	}
+	printf("PASSED\n");
+
+	if ((argc < 2) || (strcmp(argv[1], "-n") != 0)) {
+		bench_all();
+	}
+
+	return 0;
+}